@@ -0,0 +1,125 @@
+# frozen_string_literal: true
+
+require "etc"
+require "fileutils"
+require "json"
+require "time"
+require "rgeo/proj4"
+
+module RGeo
+  module Proj4
+    # Minimal benchmark runner writing its results as JSON, so that runs can
+    # be compared across commits and PROJ versions.
+    #
+    # Settings are read from the environment:
+    #
+    # [<tt>BENCH_FILTER</tt>] only run benchmarks whose name matches this regexp
+    # [<tt>BENCH_TIME</tt>] minimum seconds spent measuring each benchmark (default 0.5)
+    # [<tt>BENCH_MAX_VERTICES</tt>] largest geometry size (default 1000000)
+    # [<tt>BENCH_THREADS</tt>] largest thread count (default: number of processors)
+    # [<tt>BENCH_OUTPUT</tt>] path of the JSON report (default tmp/bench/<time>.json)
+    class Bench
+      class << self
+        # Registers a group of benchmarks, run by run with a Bench instance.
+        def register(group, &block)
+          groups[group] = block
+        end
+
+        def groups
+          @groups ||= {}
+        end
+
+        def run
+          bench = new
+          groups.each_value { |block| block.call(bench) }
+          bench.write
+        end
+      end
+
+      attr_reader :results
+
+      def initialize
+        @filter = ENV["BENCH_FILTER"] && Regexp.new(ENV["BENCH_FILTER"])
+        @min_time = Float(ENV.fetch("BENCH_TIME", "0.5"))
+        @results = []
+      end
+
+      def max_vertices
+        Integer(ENV.fetch("BENCH_MAX_VERTICES", "1000000"))
+      end
+
+      def max_threads
+        Integer(ENV.fetch("BENCH_THREADS", Etc.nprocessors.to_s))
+      end
+
+      # Sizes from 10 up to max_vertices, by powers of 10.
+      def vertex_counts
+        (1..Math.log10(max_vertices).floor).map { |exponent| 10**exponent }
+      end
+
+      # Thread counts from 1 up to max_threads, by powers of 2.
+      def thread_counts
+        counts = [1]
+        counts << counts.last * 2 while counts.last * 2 <= max_threads
+        counts << max_threads unless counts.last == max_threads
+        counts
+      end
+
+      # Measures the block, which processes +items+ items (points,
+      # definitions, lookups...) per call. The block is called once to warm
+      # up, then repeatedly for at least BENCH_TIME seconds.
+      def measure(name, items: 1, **params)
+        return if @filter && !@filter.match?(name)
+
+        yield
+        iterations = 0
+        started = clock
+        elapsed = 0.0
+        while elapsed < @min_time
+          yield
+          iterations += 1
+          elapsed = clock - started
+        end
+
+        result = {
+          name: name,
+          params: params,
+          iterations: iterations,
+          seconds: elapsed,
+          seconds_per_iteration: elapsed / iterations,
+          items_per_second: items * iterations / elapsed
+        }
+        @results << result
+        warn format("%-40<name>s %-28<params>s %14<rate>.1f items/s",
+                    name: name, params: params.map { |k, v| "#{k}=#{v}" }.join(" "),
+                    rate: result[:items_per_second])
+      end
+
+      def report
+        {
+          created_at: Time.now.utc.iso8601,
+          commit: `git rev-parse HEAD 2>/dev/null`.strip,
+          ruby: RUBY_DESCRIPTION,
+          proj: CoordSys::Proj4.version,
+          rgeo_proj4: VERSION,
+          processors: Etc.nprocessors,
+          results: @results
+        }
+      end
+
+      def write(path = ENV["BENCH_OUTPUT"])
+        path ||= File.join("tmp", "bench", "#{Time.now.utc.strftime('%Y%m%dT%H%M%S')}.json")
+        FileUtils.mkdir_p(File.dirname(path))
+        File.write(path, JSON.pretty_generate(report))
+        warn "Results written to #{path}"
+        path
+      end
+
+      private
+
+      def clock
+        Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      end
+    end
+  end
+end
@@ -0,0 +1,37 @@
+# frozen_string_literal: true
+
+require_relative "bench_helper"
+
+RGeo::Proj4::Bench.register("creation") do |bench|
+  definitions = {
+    "epsg" => "EPSG:2154",
+    "proj_string" => "+proj=lcc +lat_1=49 +lat_2=44 +lat_0=46.5 +lon_0=3 +x_0=700000 +y_0=6600000 +ellps=GRS80 " \
+                     "+towgs84=0,0,0,0,0,0,0 +units=m +no_defs +type=crs",
+    "wkt" => RGeo::CoordSys::Proj4.create("EPSG:2154").as_text
+  }
+
+  definitions.each do |input, definition|
+    bench.measure("proj4_create", input: input) do
+      RGeo::CoordSys::Proj4.create(definition, cache: false)
+    end
+    bench.measure("proj4_create_cached", input: input) do
+      RGeo::CoordSys::Proj4.create(definition)
+    end
+  end
+
+  from = RGeo::CoordSys::Proj4.create("EPSG:2154")
+  to = RGeo::CoordSys::Proj4.create("EPSG:4326")
+
+  bench.measure("crs_to_crs_create") do
+    RGeo::CoordSys::CRSToCRS.create(from, to)
+  end
+
+  store = RGeo::CoordSys::CRSStore.send(:new)
+  store.get(from, to)
+  bench.measure("crs_store_get", lookup: "hit") do
+    store.get(from, to)
+  end
+  bench.measure("crs_store_get", lookup: "miss") do
+    RGeo::CoordSys::CRSStore.send(:new).get(from, to)
+  end
+end
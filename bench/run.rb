@@ -0,0 +1,10 @@
+# frozen_string_literal: true
+
+# Runs every benchmark in this directory and writes a JSON report, see
+# bench_helper.rb for the settings. Usually run with `rake bench`.
+
+require_relative "bench_helper"
+
+Dir[File.join(__dir__, "*_bench.rb")].sort.each { |file| require file }
+
+RGeo::Proj4::Bench.run
@@ -0,0 +1,32 @@
+# frozen_string_literal: true
+
+require_relative "bench_helper"
+
+RGeo::Proj4::Bench.register("threads") do |bench|
+  from = RGeo::CoordSys::Proj4.create("EPSG:2154")
+  to = RGeo::CoordSys::Proj4.create("EPSG:4326")
+  crs_to_crs = RGeo::CoordSys::CRSStore.get(from, to)
+
+  count = [bench.max_vertices, 100_000].min
+  buffer = Array.new(count) { |i| [700_000.0 + i % 1000, 6_600_000.0 + i / 1000] }.flatten.pack("d*")
+
+  # Every thread transforms its own copy of the buffer, so the throughput
+  # should scale with the number of threads as the GVL is released.
+  bench.thread_counts.each do |threads|
+    buffers = Array.new(threads) { buffer.dup }
+    bench.measure("threaded_transform_buffer", items: count * threads, threads: threads, vertices: count) do
+      buffers.map { |data| Thread.new { crs_to_crs.transform_buffer(data, out: data.dup) } }.each(&:join)
+    end
+  end
+
+  # A single buffer split between the native worker threads.
+  workers = RGeo::CoordSys::CRSToCRS.workers
+  bench.thread_counts.each do |threads|
+    RGeo::CoordSys::CRSToCRS.workers = threads
+    out = buffer.dup
+    bench.measure("parallel_transform_buffer", items: count, workers: threads, vertices: count) do
+      crs_to_crs.transform_buffer(buffer, out: out, parallel: true)
+    end
+  end
+  RGeo::CoordSys::CRSToCRS.workers = workers
+end
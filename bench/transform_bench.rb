@@ -0,0 +1,46 @@
+# frozen_string_literal: true
+
+require_relative "bench_helper"
+
+RGeo::Proj4::Bench.register("transform") do |bench|
+  from = RGeo::CoordSys::Proj4.create("EPSG:2154")
+  to = RGeo::CoordSys::Proj4.create("EPSG:4326")
+  crs_to_crs = RGeo::CoordSys::CRSStore.get(from, to)
+  from_factory = RGeo::Cartesian.simple_factory(srid: 2154, coord_sys: from)
+  to_factory = RGeo::Cartesian.simple_factory(srid: 4326, coord_sys: to)
+
+  bench.measure("transform_coords") do
+    crs_to_crs.transform_coords(733_345.6496818807, 6_750_247.713332973, nil)
+  end
+
+  # Points on a circle around a point of France, in Lambert-93.
+  circle = lambda do |count, radius: 10_000.0, x: 700_000.0, y: 6_600_000.0|
+    Array.new(count) do |i|
+      angle = 2 * Math::PI * i / count
+      from_factory.point(x + radius * Math.cos(angle), y + radius * Math.sin(angle))
+    end
+  end
+
+  bench.vertex_counts.each do |count|
+    line_string = from_factory.line_string(circle.call(count))
+    bench.measure("transform_line_string", items: count, vertices: count) do
+      crs_to_crs.transform(line_string, to_factory)
+    end
+
+    # Disjoint polygons of 10 vertices laid out on a grid.
+    polygons = Array.new([count / 10, 1].max) do |i|
+      ring = circle.call(10, radius: 40.0, x: 700_000.0 + 100 * (i % 1000), y: 6_600_000.0 + 100 * (i / 1000))
+      from_factory.polygon(from_factory.linear_ring(ring))
+    end
+    multi_polygon = from_factory.multi_polygon(polygons)
+    bench.measure("transform_multi_polygon", items: polygons.size * 10, vertices: count) do
+      crs_to_crs.transform(multi_polygon, to_factory)
+    end
+
+    buffer = circle.call(count).flat_map { |point| [point.x, point.y] }.pack("d*")
+    out = buffer.dup
+    bench.measure("transform_buffer", items: count, vertices: count) do
+      crs_to_crs.transform_buffer(buffer, out: out)
+    end
+  end
+end
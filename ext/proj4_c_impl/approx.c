@@ -0,0 +1,269 @@
+/*
+  Adaptive grid interpolating a transform over a bounding box
+*/
+
+#include <ruby.h>
+
+#include "preface.h"
+
+#ifdef RGEO_PROJ4_SUPPORTED
+
+#include "approx.h"
+#include <math.h>
+
+RGEO_BEGIN_C
+
+// Limits on the refinement of the grid. Cells that would need more are left
+// to the exact transform.
+#define RGEO_APPROX_MAX_DEPTH 32
+#define RGEO_APPROX_MAX_CELLS 65536
+
+// Number of test points of a cell: the middles of its edges, its center and
+// the centers of its quarters.
+#define RGEO_APPROX_TESTS 9
+
+// Cell of the grid, covering [x0, x1] x [y0, y1]. Corners are numbered
+// (x0, y0), (x1, y0), (x0, y1) and (x1, y1).
+typedef struct RGeo_ApproxCell {
+  double x0;
+  double y0;
+  double x1;
+  double y1;
+  // Exact results at the corners.
+  double cx[4];
+  double cy[4];
+  // Halves of the cell, lower one first, when split along axis (0 for x, 1
+  // for y).
+  struct RGeo_ApproxCell *children;
+  char axis;
+  // Set for leaves where interpolation is not accurate enough.
+  char exact;
+} RGeo_ApproxCell;
+
+struct RGeo_ApproxGrid {
+  RGeo_ApproxCell root;
+  size_t cell_count;
+  double max_error;
+  RGeo_ApproxTransform transform;
+  void *arg;
+};
+
+// Positions of the test points, as fractions of the cell. The first four are
+// the middles of the edges, shared with the corners of the halves.
+static const double rgeo_approx_test_u[RGEO_APPROX_TESTS] = {
+    0.5, 0.5, 0.0, 1.0, 0.5, 0.25, 0.75, 0.25, 0.75};
+static const double rgeo_approx_test_v[RGEO_APPROX_TESTS] = {
+    0.0, 1.0, 0.5, 0.5, 0.5, 0.25, 0.25, 0.75, 0.75};
+
+static int rgeo_approx_valid(double x, double y) {
+  return x != HUGE_VAL && !isnan(x) && !isnan(y);
+}
+
+static void rgeo_approx_interpolate(const RGeo_ApproxCell *cell, double u,
+                                    double v, double *x, double *y) {
+  double w[4];
+  int i;
+
+  w[0] = (1.0 - u) * (1.0 - v);
+  w[1] = u * (1.0 - v);
+  w[2] = (1.0 - u) * v;
+  w[3] = u * v;
+  *x = 0.0;
+  *y = 0.0;
+  for (i = 0; i < 4; i++) {
+    *x += w[i] * cell->cx[i];
+    *y += w[i] * cell->cy[i];
+  }
+}
+
+// Transforms the corners of cell exactly.
+static void rgeo_approx_init_corners(RGeo_ApproxGrid *grid,
+                                     RGeo_ApproxCell *cell) {
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    cell->cx[i] = i & 1 ? cell->x1 : cell->x0;
+    cell->cy[i] = i & 2 ? cell->y1 : cell->y0;
+  }
+  grid->transform(grid->arg, cell->cx, cell->cy, 4);
+}
+
+// Checks the interpolation of cell at its test points, leaving the exact
+// results in tx and ty and the errors in errors (HUGE_VAL for failures).
+// Returns whether it is within the maximum error.
+static int rgeo_approx_check(RGeo_ApproxGrid *grid, RGeo_ApproxCell *cell,
+                             double *tx, double *ty, double *errors) {
+  double x;
+  double y;
+  int accurate;
+  int i;
+
+  accurate = 1;
+  for (i = 0; i < 4; i++) {
+    accurate = accurate && rgeo_approx_valid(cell->cx[i], cell->cy[i]);
+  }
+  for (i = 0; i < RGEO_APPROX_TESTS; i++) {
+    tx[i] = cell->x0 + rgeo_approx_test_u[i] * (cell->x1 - cell->x0);
+    ty[i] = cell->y0 + rgeo_approx_test_v[i] * (cell->y1 - cell->y0);
+  }
+  grid->transform(grid->arg, tx, ty, RGEO_APPROX_TESTS);
+  for (i = 0; i < RGEO_APPROX_TESTS; i++) {
+    rgeo_approx_interpolate(cell, rgeo_approx_test_u[i],
+                            rgeo_approx_test_v[i], &x, &y);
+    errors[i] = rgeo_approx_valid(tx[i], ty[i])
+                    ? hypot(x - tx[i], y - ty[i])
+                    : HUGE_VAL;
+    accurate = accurate && errors[i] <= grid->max_error;
+  }
+  return accurate;
+}
+
+// Splits cell in halves along the axis where interpolation is the furthest
+// off at the middles of the edges, so that a transform that is linear along
+// one axis, like Mercator along x, is only refined along the other one.
+// Middles of the edges become corners of the halves.
+static void rgeo_approx_split(RGeo_ApproxGrid *grid, RGeo_ApproxCell *cell,
+                              const double *tx, const double *ty,
+                              const double *errors, int depth) {
+  double error_x;
+  double error_y;
+  RGeo_ApproxCell *low;
+  RGeo_ApproxCell *high;
+
+  error_x = fmax(errors[0], errors[1]);
+  error_y = fmax(errors[2], errors[3]);
+  cell->axis = error_x > error_y ? 0 : error_y > error_x ? 1 : depth % 2;
+  cell->children = ALLOC_N(RGeo_ApproxCell, 2);
+  grid->cell_count += 2;
+  low = &cell->children[0];
+  high = &cell->children[1];
+  *low = *cell;
+  *high = *cell;
+  low->children = high->children = NULL;
+  low->exact = high->exact = 0;
+  if (cell->axis == 0) {
+    low->x1 = high->x0 = 0.5 * (cell->x0 + cell->x1);
+    low->cx[1] = high->cx[0] = tx[0];
+    low->cy[1] = high->cy[0] = ty[0];
+    low->cx[3] = high->cx[2] = tx[1];
+    low->cy[3] = high->cy[2] = ty[1];
+  } else {
+    low->y1 = high->y0 = 0.5 * (cell->y0 + cell->y1);
+    low->cx[2] = high->cx[0] = tx[2];
+    low->cy[2] = high->cy[0] = ty[2];
+    low->cx[3] = high->cx[1] = tx[3];
+    low->cy[3] = high->cy[1] = ty[3];
+  }
+}
+
+// Refines the grid level by level, so that when the cell limit is reached
+// the cells left to the exact transform are the smallest ones rather than
+// a whole part of the bounds.
+static void rgeo_approx_refine(RGeo_ApproxGrid *grid) {
+  RGeo_ApproxCell **queue;
+  size_t capacity;
+  size_t head;
+  size_t tail;
+  size_t level_end;
+  RGeo_ApproxCell *cell;
+  double tx[RGEO_APPROX_TESTS];
+  double ty[RGEO_APPROX_TESTS];
+  double errors[RGEO_APPROX_TESTS];
+  int depth;
+
+  capacity = 64;
+  queue = ALLOC_N(RGeo_ApproxCell *, capacity);
+  queue[0] = &grid->root;
+  head = 0;
+  tail = 1;
+  level_end = 1;
+  depth = 0;
+  while (head < tail) {
+    if (head == level_end) {
+      level_end = tail;
+      depth++;
+    }
+    cell = queue[head++];
+    if (rgeo_approx_check(grid, cell, tx, ty, errors)) {
+      continue;
+    }
+    if (depth >= RGEO_APPROX_MAX_DEPTH ||
+        grid->cell_count + 2 > RGEO_APPROX_MAX_CELLS) {
+      cell->exact = 1;
+      continue;
+    }
+    rgeo_approx_split(grid, cell, tx, ty, errors, depth);
+    if (tail + 2 > capacity) {
+      capacity *= 2;
+      REALLOC_N(queue, RGeo_ApproxCell *, capacity);
+    }
+    queue[tail++] = &cell->children[0];
+    queue[tail++] = &cell->children[1];
+  }
+  FREE(queue);
+}
+
+static void rgeo_approx_free_cell(RGeo_ApproxCell *cell) {
+  if (cell->children) {
+    rgeo_approx_free_cell(&cell->children[0]);
+    rgeo_approx_free_cell(&cell->children[1]);
+    FREE(cell->children);
+  }
+}
+
+RGeo_ApproxGrid *rgeo_approx_build(const double *bounds, double max_error,
+                                   RGeo_ApproxTransform transform, void *arg) {
+  RGeo_ApproxGrid *grid;
+
+  grid = ALLOC(RGeo_ApproxGrid);
+  grid->root.x0 = bounds[0];
+  grid->root.y0 = bounds[1];
+  grid->root.x1 = bounds[2];
+  grid->root.y1 = bounds[3];
+  grid->root.children = NULL;
+  grid->root.exact = 0;
+  grid->cell_count = 1;
+  grid->max_error = max_error;
+  grid->transform = transform;
+  grid->arg = arg;
+  rgeo_approx_init_corners(grid, &grid->root);
+  rgeo_approx_refine(grid);
+  grid->transform = NULL;
+  grid->arg = NULL;
+  return grid;
+}
+
+void rgeo_approx_free(RGeo_ApproxGrid *grid) {
+  if (grid) {
+    rgeo_approx_free_cell(&grid->root);
+    FREE(grid);
+  }
+}
+
+size_t rgeo_approx_memsize(const RGeo_ApproxGrid *grid) {
+  return sizeof(*grid) + (grid->cell_count - 1) * sizeof(RGeo_ApproxCell);
+}
+
+int rgeo_approx_eval(const RGeo_ApproxGrid *grid, double *x, double *y) {
+  const RGeo_ApproxCell *cell;
+
+  cell = &grid->root;
+  if (!(*x >= cell->x0 && *x <= cell->x1 && *y >= cell->y0 &&
+        *y <= cell->y1)) {
+    return 0;
+  }
+  while (cell->children) {
+    cell = &cell->children[cell->axis == 0 ? *x >= cell->children[1].x0
+                                            : *y >= cell->children[1].y0];
+  }
+  if (cell->exact) {
+    return 0;
+  }
+  rgeo_approx_interpolate(cell, (*x - cell->x0) / (cell->x1 - cell->x0),
+                          (*y - cell->y0) / (cell->y1 - cell->y0), x, y);
+  return 1;
+}
+
+RGEO_END_C
+
+#endif // RGEO_PROJ4_SUPPORTED
@@ -0,0 +1,39 @@
+#ifndef RGEO_PROJ4_APPROX_INCLUDED
+#define RGEO_PROJ4_APPROX_INCLUDED
+
+#include <ruby.h>
+
+#ifdef RGEO_PROJ4_SUPPORTED
+
+RGEO_BEGIN_C
+
+// Transforms count points in place, exactly, setting the x of failures to
+// HUGE_VAL.
+typedef void (*RGeo_ApproxTransform)(void *arg, double *x, double *y,
+                                     size_t count);
+
+typedef struct RGeo_ApproxGrid RGeo_ApproxGrid;
+
+// Builds a grid interpolating transform over bounds (xmin, ymin, xmax,
+// ymax). Cells are split until bilinear interpolation of the exact results
+// at their corners is within max_error of the exact results at test points
+// inside them. Cells still off after the last split are left to the exact
+// transform. Must be called with the GVL held.
+RGeo_ApproxGrid *rgeo_approx_build(const double *bounds, double max_error,
+                                   RGeo_ApproxTransform transform, void *arg);
+
+void rgeo_approx_free(RGeo_ApproxGrid *grid);
+
+size_t rgeo_approx_memsize(const RGeo_ApproxGrid *grid);
+
+// Interpolates the transform of the point at x, y in place. Returns 0,
+// leaving the point untouched, when it has to be transformed exactly: out of
+// the bounds of the grid or in a cell where interpolation is not accurate
+// enough. Safe to call without the GVL.
+int rgeo_approx_eval(const RGeo_ApproxGrid *grid, double *x, double *y);
+
+RGEO_END_C
+
+#endif // RGEO_PROJ4_SUPPORTED
+
+#endif // RGEO_PROJ4_APPROX_INCLUDED
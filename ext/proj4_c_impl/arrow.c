@@ -0,0 +1,48 @@
+/*
+  Access to float64 columns exported through the Arrow C Data Interface
+*/
+
+#include <ruby.h>
+
+#include "preface.h"
+
+#ifdef RGEO_PROJ4_SUPPORTED
+
+#include "arrow.h"
+#include <string.h>
+
+RGEO_BEGIN_C
+
+const char *rgeo_arrow_float64_values(const struct ArrowArray *array,
+                                      const struct ArrowSchema *schema,
+                                      double **values, size_t *length) {
+  if (!array || !schema) {
+    return "null Arrow array or schema";
+  }
+  if (!array->release || !schema->release) {
+    return "Arrow array or schema was released";
+  }
+  if (!schema->format || strcmp(schema->format, "g") != 0) {
+    return "Arrow array is not of type float64";
+  }
+  if (array->n_buffers != 2 || array->length < 0 || array->offset < 0) {
+    return "invalid float64 Arrow array";
+  }
+
+  *length = (size_t)array->length;
+  *values = NULL;
+  if (*length > 0) {
+    if (!array->buffers[1]) {
+      return "Arrow array has no values buffer";
+    }
+    *values = (double *)array->buffers[1] + array->offset;
+    if ((uintptr_t)*values % sizeof(double) != 0) {
+      return "Arrow values are not aligned on a double boundary";
+    }
+  }
+  return NULL;
+}
+
+RGEO_END_C
+
+#endif // RGEO_PROJ4_SUPPORTED
@@ -0,0 +1,69 @@
+#ifndef RGEO_PROJ4_ARROW_INCLUDED
+#define RGEO_PROJ4_ARROW_INCLUDED
+
+#include <ruby.h>
+
+#ifdef RGEO_PROJ4_SUPPORTED
+
+#include <stdint.h>
+
+RGEO_BEGIN_C
+
+// Structures of the Arrow C Data Interface, as given by its specification
+// (https://arrow.apache.org/docs/format/CDataInterface.html). They are an
+// ABI shared by every Arrow implementation, no Arrow library is needed.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  // Array type description
+  const char *format;
+  const char *name;
+  const char *metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema **children;
+  struct ArrowSchema *dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowSchema *);
+  // Opaque producer-specific data
+  void *private_data;
+};
+
+struct ArrowArray {
+  // Array data description
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void **buffers;
+  struct ArrowArray **children;
+  struct ArrowArray *dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowArray *);
+  // Opaque producer-specific data
+  void *private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+// Finds the values of a float64 Arrow array described by schema. Returns
+// NULL, or a message describing why the array cannot be used. Slots marked
+// null in the validity bitmap hold unspecified values, which are
+// transformed along with the others.
+const char *rgeo_arrow_float64_values(const struct ArrowArray *array,
+                                      const struct ArrowSchema *schema,
+                                      double **values, size_t *length);
+
+RGEO_END_C
+
+#endif // RGEO_PROJ4_SUPPORTED
+
+#endif // RGEO_PROJ4_ARROW_INCLUDED
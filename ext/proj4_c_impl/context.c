@@ -0,0 +1,112 @@
+/*
+  Pool of PROJ contexts shared by every thread and Ractor
+*/
+
+#include <ruby.h>
+#include <ruby/thread_native.h>
+
+#include "preface.h"
+
+#ifdef RGEO_PROJ4_SUPPORTED
+
+#include "context.h"
+
+#ifdef HAVE_PTHREAD_ATFORK
+#include <pthread.h>
+#endif
+
+RGEO_BEGIN_C
+
+typedef struct RGeo_ContextEntry {
+  PJ_CONTEXT *ctx;
+  char in_use;
+  unsigned int generation;
+  struct RGeo_ContextEntry *next;
+} RGeo_ContextEntry;
+
+// Every context ever handed out. Contexts are never destroyed: PJ objects
+// created or cloned with a context keep a pointer to it, so a context must
+// outlive every object made with it. The pool only grows up to the highest
+// number of threads and Ractors using PROJ at the same time.
+static RGeo_ContextEntry *contexts;
+static rb_nativethread_lock_t contexts_lock;
+
+// Incremented in the child process after each fork. Entries from an older
+// generation hold a context inherited from the parent.
+static unsigned int fork_generation;
+
+#ifdef HAVE_PTHREAD_ATFORK
+// Only the forking thread survives a fork, so contexts leased by other threads
+// are never handed back, and the PROJ database handles inherited from the
+// parent must not be used by the child (see
+// https://github.com/rgeo/rgeo-proj4/issues/39). Contexts are replaced lazily
+// on their next lease, this handler only does what is safe right after fork.
+static void rgeo_proj_context_atfork_child(void) {
+  rb_nativethread_lock_initialize(&contexts_lock);
+  fork_generation++;
+}
+#endif
+
+// Must be called with the GVL held, as growing the pool allocates.
+PJ_CONTEXT *rgeo_proj_context_acquire() {
+  RGeo_ContextEntry *entry;
+  PJ_CONTEXT *ctx;
+
+  ctx = NULL;
+  rb_nativethread_lock_lock(&contexts_lock);
+  for (entry = contexts; entry; entry = entry->next) {
+    if (entry->generation != fork_generation) {
+      // The inherited context is left alone rather than destroyed, objects
+      // created in the parent may still point to it.
+      entry->ctx = proj_context_create();
+      entry->generation = fork_generation;
+      entry->in_use = 0;
+    }
+    if (!entry->in_use && entry->ctx) {
+      entry->in_use = 1;
+      ctx = entry->ctx;
+      break;
+    }
+  }
+  rb_nativethread_lock_unlock(&contexts_lock);
+
+  if (!ctx) {
+    ctx = proj_context_create();
+    entry = ALLOC(RGeo_ContextEntry);
+    entry->ctx = ctx;
+    entry->in_use = 1;
+
+    rb_nativethread_lock_lock(&contexts_lock);
+    entry->generation = fork_generation;
+    entry->next = contexts;
+    contexts = entry;
+    rb_nativethread_lock_unlock(&contexts_lock);
+  }
+  return ctx;
+}
+
+void rgeo_proj_context_release(PJ_CONTEXT *ctx) {
+  RGeo_ContextEntry *entry;
+
+  rb_nativethread_lock_lock(&contexts_lock);
+  for (entry = contexts; entry; entry = entry->next) {
+    if (entry->ctx == ctx) {
+      entry->in_use = 0;
+      break;
+    }
+  }
+  rb_nativethread_lock_unlock(&contexts_lock);
+}
+
+void rgeo_init_proj_context() {
+  contexts = NULL;
+  fork_generation = 0;
+  rb_nativethread_lock_initialize(&contexts_lock);
+#ifdef HAVE_PTHREAD_ATFORK
+  pthread_atfork(NULL, NULL, rgeo_proj_context_atfork_child);
+#endif
+}
+
+RGEO_END_C
+
+#endif // RGEO_PROJ4_SUPPORTED
@@ -0,0 +1,26 @@
+#ifndef RGEO_PROJ4_CONTEXT_INCLUDED
+#define RGEO_PROJ4_CONTEXT_INCLUDED
+
+#include <ruby.h>
+
+#ifdef RGEO_PROJ4_SUPPORTED
+
+#include <proj.h>
+
+RGEO_BEGIN_C
+
+// Leases a PROJ context for exclusive use by the calling thread. Contexts
+// are not thread-safe, so any PROJ work done outside of the GVL must run on
+// a leased context and hand it back with rgeo_proj_context_release. Leasing
+// must happen with the GVL held, releasing may happen anywhere.
+PJ_CONTEXT *rgeo_proj_context_acquire();
+
+void rgeo_proj_context_release(PJ_CONTEXT *ctx);
+
+void rgeo_init_proj_context();
+
+RGEO_END_C
+
+#endif // RGEO_PROJ4_SUPPORTED
+
+#endif // RGEO_PROJ4_CONTEXT_INCLUDED
@@ -14,6 +14,7 @@ RGEO_BEGIN_C
 VALUE error_module;
 VALUE rb_eRGeoError;
 VALUE rb_eRGeoInvalidProjectionError;
+VALUE rb_eRGeoTransformError;
 
 void rgeo_init_proj_errors() {
   VALUE rgeo_module;
@@ -24,6 +25,8 @@ void rgeo_init_proj_errors() {
       rb_define_class_under(error_module, "RGeoError", rb_eRuntimeError);
   rb_eRGeoInvalidProjectionError =
       rb_define_class_under(error_module, "InvalidProjection", rb_eRGeoError);
+  rb_eRGeoTransformError = rb_define_class_under(
+      error_module, "TransformError", rb_eRGeoInvalidProjectionError);
 }
 
 RGEO_END_C
@@ -12,6 +12,8 @@ extern VALUE error_module;
 extern VALUE rb_eRGeoError;
 // RGeo::Error::InvalidProjection
 extern VALUE rb_eRGeoInvalidProjectionError;
+// RGeo::Error::TransformError
+extern VALUE rb_eRGeoTransformError;
 
 void rgeo_init_proj_errors();
 
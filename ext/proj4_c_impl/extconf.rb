@@ -71,8 +71,15 @@ else
     found_valid_proj_version = required_proj_funcs.all? do |func|
       have_func(func, "proj.h")
     end
+    have_func("proj_clone", "proj.h")
+    have_func("proj_trans_bounds", "proj.h")
   end
   have_func("rb_gc_mark_movable")
+  have_func("rb_ext_ractor_safe", "ruby.h")
+  have_func("pthread_atfork", "pthread.h")
+  have_func("clock_gettime", "time.h")
+  have_func("pthread_create", "pthread.h")
+  have_func("rb_io_buffer_get_bytes_for_writing", "ruby/io/buffer.h")
 
   unless found_proj
 
@@ -0,0 +1,601 @@
+/*
+  Closed-form transforms replacing the pipelines between well-known CRSs
+*/
+
+#include <ruby.h>
+#include <ruby/thread_native.h>
+
+#include "preface.h"
+
+#ifdef RGEO_PROJ4_SUPPORTED
+
+#include "kernels.h"
+#include <math.h>
+#include <stdio.h>
+
+RGEO_BEGIN_C
+
+#define RGEO_KERNEL_PI 3.14159265358979323846
+#define RGEO_KERNEL_RADIANS_PER_DEGREE (RGEO_KERNEL_PI / 180.0)
+
+// WGS 84 ellipsoid, also the sphere of Web Mercator.
+#define RGEO_KERNEL_A 6378137.0
+#define RGEO_KERNEL_F (1.0 / 298.257223563)
+
+// Web Mercator is not defined at the poles, latitudes closer to them are
+// left to PROJ.
+#define RGEO_KERNEL_MERCATOR_MAX_LATITUDE 89.99999
+
+// Easting of the transverse Mercator, in the complex plane, beyond which
+// PROJ fails (150 degrees from the central meridian).
+#define RGEO_KERNEL_TMERC_MAX_EASTING 2.623395162778
+
+#define RGEO_KERNEL_UTM_SCALE 0.9996
+#define RGEO_KERNEL_UTM_FALSE_EASTING 500000.0
+#define RGEO_KERNEL_UTM_FALSE_NORTHING_SOUTH 10000000.0
+
+static int kernels_enabled = 1;
+
+#define RGEO_KERNEL_UTM_ZONES 60
+
+// Reference CRS a kernel is picked for, created on first use.
+typedef struct {
+  PJ *pj;
+  char created;
+} RGeo_KernelReference;
+
+// Reference CRSs created with one of the pooled contexts, each defined both
+// by its EPSG code and by its PROJ string. They are only used by whoever
+// leased the context, and kept as long as the context.
+typedef struct RGeo_KernelReferences {
+  PJ_CONTEXT *ctx;
+  RGeo_KernelReference geographic[2];
+  RGeo_KernelReference web_mercator[2];
+  // Indexed by hemisphere (north, south) then zone.
+  RGeo_KernelReference utm[2][RGEO_KERNEL_UTM_ZONES][2];
+  struct RGeo_KernelReferences *next;
+} RGeo_KernelReferences;
+
+static RGeo_KernelReferences *kernel_references;
+static rb_nativethread_lock_t kernel_references_lock;
+
+// Longitudes and latitudes, in degrees, on which kernels are checked
+// against PROJ. UTM kernels use the longitudes divided by 60 as offsets
+// from the central meridian of their zone.
+static const double rgeo_kernel_samples[][2] = {
+    {0.0, 0.0},     {2.35, 48.85},  {-73.98, 40.75}, {151.21, -33.87},
+    {-179.5, 80.0}, {179.9, -84.0}, {12.5, -0.5}};
+
+#define RGEO_KERNEL_SAMPLE_COUNT                                               \
+  (sizeof(rgeo_kernel_samples) / sizeof(rgeo_kernel_samples[0]))
+
+// Brings lam back in [-pi, pi], as PROJ does.
+static double rgeo_kernel_adjlon(double lam) {
+  if (fabs(lam) < RGEO_KERNEL_PI + 1e-12) {
+    return lam;
+  }
+  lam += RGEO_KERNEL_PI;
+  lam -= 2 * RGEO_KERNEL_PI * floor(lam / (2 * RGEO_KERNEL_PI));
+  return lam - RGEO_KERNEL_PI;
+}
+
+static int rgeo_kernel_identity(const RGeo_Kernel *kernel, double *x,
+                                double *y) {
+  return 1;
+}
+
+static int rgeo_kernel_web_mercator_fwd(const RGeo_Kernel *kernel, double *x,
+                                        double *y) {
+  double lam;
+  double phi;
+
+  // NaNs fail the comparisons, and are left to PROJ too.
+  if (!(fabs(*x) <= 180.0 && fabs(*y) <= RGEO_KERNEL_MERCATOR_MAX_LATITUDE)) {
+    return 0;
+  }
+  lam = *x * RGEO_KERNEL_RADIANS_PER_DEGREE;
+  phi = *y * RGEO_KERNEL_RADIANS_PER_DEGREE;
+  *x = RGEO_KERNEL_A * lam;
+  *y = RGEO_KERNEL_A * asinh(tan(phi));
+  return 1;
+}
+
+static int rgeo_kernel_web_mercator_inv(const RGeo_Kernel *kernel, double *x,
+                                        double *y) {
+  double lam;
+  double phi;
+
+  if (!(fabs(*x) <= RGEO_KERNEL_A * RGEO_KERNEL_PI && isfinite(*y))) {
+    return 0;
+  }
+  lam = *x / RGEO_KERNEL_A;
+  phi = atan(sinh(*y / RGEO_KERNEL_A));
+  *x = lam / RGEO_KERNEL_RADIANS_PER_DEGREE;
+  *y = phi / RGEO_KERNEL_RADIANS_PER_DEGREE;
+  return 1;
+}
+
+// Clenshaw summation of the series p at 2 * b, added to b: conversion
+// between geodetic and Gaussian latitudes.
+static double rgeo_kernel_gatg(const double *p, double b) {
+  double two_cos_2b;
+  double h;
+  double h1;
+  double h2;
+  int i;
+
+  two_cos_2b = 2 * cos(2 * b);
+  h1 = p[RGEO_KERNEL_TMERC_ORDER - 1];
+  h2 = 0.0;
+  h = h1;
+  for (i = RGEO_KERNEL_TMERC_ORDER - 2; i >= 0; i--) {
+    h = -h2 + two_cos_2b * h1 + p[i];
+    h2 = h1;
+    h1 = h;
+  }
+  return b + h * sin(2 * b);
+}
+
+// Clenshaw summation of the series a at the complex arg_r + i arg_i. Returns
+// the real part, and sets the imaginary one in im.
+static double rgeo_kernel_clens(const double *a, double arg_r, double arg_i,
+                                double *im) {
+  double sin_r;
+  double cos_r;
+  double sinh_i;
+  double cosh_i;
+  double r;
+  double i;
+  double hr;
+  double hr1;
+  double hr2;
+  double hi;
+  double hi1;
+  double hi2;
+  int k;
+
+  sin_r = sin(arg_r);
+  cos_r = cos(arg_r);
+  sinh_i = sinh(arg_i);
+  cosh_i = cosh(arg_i);
+  r = 2 * cos_r * cosh_i;
+  i = -2 * sin_r * sinh_i;
+  hr = a[RGEO_KERNEL_TMERC_ORDER - 1];
+  hi = 0.0;
+  hr1 = 0.0;
+  hi1 = 0.0;
+  for (k = RGEO_KERNEL_TMERC_ORDER - 2; k >= 0; k--) {
+    hr2 = hr1;
+    hi2 = hi1;
+    hr1 = hr;
+    hi1 = hi;
+    hr = -hr2 + r * hr1 - i * hi1 + a[k];
+    hi = -hi2 + i * hr1 + r * hi1;
+  }
+  r = sin_r * cosh_i;
+  i = cos_r * sinh_i;
+  *im = r * hi + i * hr;
+  return r * hr - i * hi;
+}
+
+static int rgeo_kernel_utm_fwd(const RGeo_Kernel *kernel, double *x,
+                               double *y) {
+  double lam;
+  double cn;
+  double ce;
+  double sin_cn;
+  double cos_cn;
+  double sin_ce;
+  double cos_ce;
+  double dce;
+
+  if (!(fabs(*x) <= 180.0 && fabs(*y) <= 90.0)) {
+    return 0;
+  }
+  lam = rgeo_kernel_adjlon(*x * RGEO_KERNEL_RADIANS_PER_DEGREE - kernel->lam0);
+  cn = rgeo_kernel_gatg(kernel->cbg, *y * RGEO_KERNEL_RADIANS_PER_DEGREE);
+  sin_cn = sin(cn);
+  cos_cn = cos(cn);
+  sin_ce = sin(lam);
+  cos_ce = cos(lam);
+  cn = atan2(sin_cn, cos_ce * cos_cn);
+  ce = asinh(tan(atan2(sin_ce * cos_cn, hypot(sin_cn, cos_cn * cos_ce))));
+  cn += rgeo_kernel_clens(kernel->gtu, 2 * cn, 2 * ce, &dce);
+  ce += dce;
+  if (!(fabs(ce) <= RGEO_KERNEL_TMERC_MAX_EASTING)) {
+    return 0;
+  }
+  *x = RGEO_KERNEL_A * kernel->qn * ce + RGEO_KERNEL_UTM_FALSE_EASTING;
+  *y = RGEO_KERNEL_A * kernel->qn * cn + kernel->y0;
+  return 1;
+}
+
+static int rgeo_kernel_utm_inv(const RGeo_Kernel *kernel, double *x,
+                               double *y) {
+  double cn;
+  double ce;
+  double sin_cn;
+  double cos_cn;
+  double sin_ce;
+  double cos_ce;
+  double dce;
+
+  cn = (*y - kernel->y0) / (RGEO_KERNEL_A * kernel->qn);
+  ce = (*x - RGEO_KERNEL_UTM_FALSE_EASTING) / (RGEO_KERNEL_A * kernel->qn);
+  if (!(fabs(ce) <= RGEO_KERNEL_TMERC_MAX_EASTING && isfinite(cn))) {
+    return 0;
+  }
+  cn += rgeo_kernel_clens(kernel->utg, 2 * cn, 2 * ce, &dce);
+  ce = atan(sinh(ce + dce));
+  sin_cn = sin(cn);
+  cos_cn = cos(cn);
+  sin_ce = sin(ce);
+  cos_ce = cos(ce);
+  ce = atan2(sin_ce, cos_ce * cos_cn);
+  cn = atan2(sin_cn * cos_ce, hypot(sin_ce, cos_ce * cos_cn));
+  *x = rgeo_kernel_adjlon(ce + kernel->lam0) / RGEO_KERNEL_RADIANS_PER_DEGREE;
+  *y = rgeo_kernel_gatg(kernel->cgb, cn) / RGEO_KERNEL_RADIANS_PER_DEGREE;
+  return 1;
+}
+
+// Sets up the Poder/Engsager transverse Mercator of UTM zone on WGS 84, with
+// the coefficients PROJ uses (Engsager and Poder, ICC 2007).
+static void rgeo_kernel_utm_init(RGeo_Kernel *kernel, int zone, int south) {
+  double es;
+  double f;
+  double n;
+  double np;
+
+  kernel->type = RGEO_KERNEL_UTM;
+  kernel->zone = zone;
+  kernel->lam0 = (zone - 0.5) * RGEO_KERNEL_PI / 30.0 - RGEO_KERNEL_PI;
+  kernel->y0 = south ? RGEO_KERNEL_UTM_FALSE_NORTHING_SOUTH : 0.0;
+
+  es = RGEO_KERNEL_F * (2 - RGEO_KERNEL_F);
+  f = es / (1 + sqrt(1 - es));
+  n = f / (2 - f);
+  np = n;
+
+  kernel->cgb[0] =
+      n * (2 + n * (-2 / 3.0 +
+                    n * (-2 + n * (116 / 45.0 +
+                                   n * (26 / 45.0 + n * (-2854 / 675.0))))));
+  kernel->cbg[0] =
+      n * (-2 + n * (2 / 3.0 +
+                     n * (4 / 3.0 + n * (-82 / 45.0 +
+                                         n * (32 / 45.0 +
+                                              n * (4642 / 4725.0))))));
+  np *= n;
+  kernel->cgb[1] =
+      np * (7 / 3.0 +
+            n * (-8 / 5.0 +
+                 n * (-227 / 45.0 + n * (2704 / 315.0 + n * (2323 / 945.0)))));
+  kernel->cbg[1] =
+      np * (5 / 3.0 +
+            n * (-16 / 15.0 +
+                 n * (-13 / 9.0 + n * (904 / 315.0 + n * (-1522 / 945.0)))));
+  np *= n;
+  kernel->cgb[2] =
+      np * (56 / 15.0 +
+            n * (-136 / 35.0 + n * (-1262 / 105.0 + n * (73814 / 2835.0))));
+  kernel->cbg[2] =
+      np * (-26 / 15.0 +
+            n * (34 / 21.0 + n * (8 / 5.0 + n * (-12686 / 2835.0))));
+  np *= n;
+  kernel->cgb[3] =
+      np * (4279 / 630.0 + n * (-332 / 35.0 + n * (-399572 / 14175.0)));
+  kernel->cbg[3] =
+      np * (1237 / 630.0 + n * (-12 / 5.0 + n * (-24832 / 14175.0)));
+  np *= n;
+  kernel->cgb[4] = np * (4174 / 315.0 + n * (-144838 / 6237.0));
+  kernel->cbg[4] = np * (-734 / 315.0 + n * (109598 / 31185.0));
+  np *= n;
+  kernel->cgb[5] = np * (601676 / 22275.0);
+  kernel->cbg[5] = np * (444337 / 155925.0);
+
+  np = n * n;
+  kernel->qn = RGEO_KERNEL_UTM_SCALE / (1 + n) *
+               (1 + np * (1 / 4.0 + np * (1 / 64.0 + np / 256.0)));
+  kernel->utg[0] =
+      n * (-0.5 +
+           n * (2 / 3.0 +
+                n * (-37 / 96.0 +
+                     n * (1 / 360.0 +
+                          n * (81 / 512.0 + n * (-96199 / 604800.0))))));
+  kernel->gtu[0] =
+      n * (0.5 +
+           n * (-2 / 3.0 +
+                n * (5 / 16.0 +
+                     n * (41 / 180.0 +
+                          n * (-127 / 288.0 + n * (7891 / 37800.0))))));
+  kernel->utg[1] =
+      np * (-1 / 48.0 +
+            n * (-1 / 15.0 +
+                 n * (437 / 1440.0 +
+                      n * (-46 / 105.0 + n * (1118711 / 3870720.0)))));
+  kernel->gtu[1] =
+      np * (13 / 48.0 +
+            n * (-3 / 5.0 +
+                 n * (557 / 1440.0 +
+                      n * (281 / 630.0 + n * (-1983433 / 1935360.0)))));
+  np *= n;
+  kernel->utg[2] =
+      np * (-17 / 480.0 +
+            n * (37 / 840.0 + n * (209 / 4480.0 + n * (-5569 / 90720.0))));
+  kernel->gtu[2] =
+      np * (61 / 240.0 +
+            n * (-103 / 140.0 +
+                 n * (15061 / 26880.0 + n * (167603 / 181440.0))));
+  np *= n;
+  kernel->utg[3] =
+      np * (-4397 / 161280.0 + n * (11 / 504.0 + n * (830251 / 7257600.0)));
+  kernel->gtu[3] =
+      np * (49561 / 161280.0 + n * (-179 / 168.0 + n * (6601661 / 7257600.0)));
+  np *= n;
+  kernel->utg[4] = np * (-4583 / 161280.0 + n * (108847 / 3991680.0));
+  kernel->gtu[4] = np * (34729 / 80640.0 + n * (-3418889 / 1995840.0));
+  np *= n;
+  kernel->utg[5] = np * (-20648693 / 638668800.0);
+  kernel->gtu[5] = np * (212378941 / 319334400.0);
+}
+
+RGeo_KernelFunc rgeo_kernel_func(const RGeo_Kernel *kernel,
+                                 PJ_DIRECTION direction) {
+  int forward;
+
+  forward = (direction == PJ_FWD) != kernel->inverse;
+  switch (kernel->type) {
+  case RGEO_KERNEL_IDENTITY:
+    return rgeo_kernel_identity;
+  case RGEO_KERNEL_WEB_MERCATOR:
+    return forward ? rgeo_kernel_web_mercator_fwd
+                   : rgeo_kernel_web_mercator_inv;
+  case RGEO_KERNEL_UTM:
+    return forward ? rgeo_kernel_utm_fwd : rgeo_kernel_utm_inv;
+  default:
+    return NULL;
+  }
+}
+
+const char *rgeo_kernel_name(const RGeo_Kernel *kernel) {
+  switch (kernel->type) {
+  case RGEO_KERNEL_IDENTITY:
+    return "identity";
+  case RGEO_KERNEL_WEB_MERCATOR:
+    return "web_mercator";
+  case RGEO_KERNEL_UTM:
+    return "utm";
+  default:
+    return NULL;
+  }
+}
+
+// Returns the reference CRSs of ctx, a context leased by the caller. Must
+// be called with the GVL held.
+static RGeo_KernelReferences *rgeo_kernel_references(PJ_CONTEXT *ctx) {
+  RGeo_KernelReferences *references;
+
+  rb_nativethread_lock_lock(&kernel_references_lock);
+  for (references = kernel_references; references;
+       references = references->next) {
+    if (references->ctx == ctx) {
+      break;
+    }
+  }
+  rb_nativethread_lock_unlock(&kernel_references_lock);
+
+  if (!references) {
+    references = ALLOC(RGeo_KernelReferences);
+    MEMZERO(references, RGeo_KernelReferences, 1);
+    references->ctx = ctx;
+
+    rb_nativethread_lock_lock(&kernel_references_lock);
+    references->next = kernel_references;
+    kernel_references = references;
+    rb_nativethread_lock_unlock(&kernel_references_lock);
+  }
+  return references;
+}
+
+// Returns whether crs is equivalent, under criterion, to one of the two
+// references, created from definitions when first compared.
+static int rgeo_kernel_crs_matches(PJ_CONTEXT *ctx, const PJ *crs,
+                                   RGeo_KernelReference *references,
+                                   const char *const *definitions,
+                                   PJ_COMPARISON_CRITERION criterion) {
+  int i;
+
+  for (i = 0; i < 2; i++) {
+    if (!references[i].created) {
+      references[i].pj = proj_create(ctx, definitions[i]);
+      references[i].created = 1;
+    }
+    if (references[i].pj &&
+        proj_is_equivalent_to(crs, references[i].pj, criterion)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Finds the UTM zone of a projected CRS on WGS 84, from the name PROJ gives
+// its conversion. Returns 0 when it is not one, setting south otherwise.
+static int rgeo_kernel_utm_zone(PJ_CONTEXT *ctx,
+                                RGeo_KernelReferences *references,
+                                const PJ *crs, int *south) {
+  PJ *conversion;
+  const char *name;
+  char hemisphere;
+  char epsg[16];
+  char utm[96];
+  const char *definitions[2];
+  int zone;
+
+  zone = 0;
+  hemisphere = 'N';
+  conversion = proj_crs_get_coordoperation(ctx, crs);
+  if (conversion) {
+    name = proj_get_name(conversion);
+    if (!name || sscanf(name, "UTM zone %d%c", &zone, &hemisphere) != 2 ||
+        zone < 1 || zone > RGEO_KERNEL_UTM_ZONES ||
+        (hemisphere != 'N' && hemisphere != 'S')) {
+      zone = 0;
+    }
+    proj_destroy(conversion);
+  }
+  if (!zone) {
+    return 0;
+  }
+
+  *south = hemisphere == 'S';
+  snprintf(epsg, sizeof(epsg), "EPSG:32%d%02d", *south ? 7 : 6, zone);
+  snprintf(utm, sizeof(utm),
+           "+proj=utm +zone=%d%s +datum=WGS84 +units=m +no_defs +type=crs",
+           zone, *south ? " +south" : "");
+  definitions[0] = epsg;
+  definitions[1] = utm;
+  return rgeo_kernel_crs_matches(ctx, crs,
+                                 references->utm[*south][zone - 1],
+                                 definitions, PJ_COMP_EQUIVALENT)
+             ? zone
+             : 0;
+}
+
+static int rgeo_kernel_close(double x, double y, PJ_COORD expected,
+                             double tolerance) {
+  return fabs(x - expected.xy.x) <= tolerance &&
+         fabs(y - expected.xy.y) <= tolerance;
+}
+
+// Runs the samples through kernel and pipeline, from the geographic CRS to
+// the projected one and back, and returns whether they agree.
+static int rgeo_kernel_verify(const RGeo_Kernel *kernel, PJ *pipeline) {
+  PJ_DIRECTION fwd;
+  PJ_DIRECTION inv;
+  RGeo_KernelFunc fwd_func;
+  RGeo_KernelFunc inv_func;
+  PJ_COORD coord;
+  double fwd_tolerance;
+  double x;
+  double y;
+  int has_inverse;
+  size_t i;
+
+  fwd = kernel->inverse ? PJ_INV : PJ_FWD;
+  inv = kernel->inverse ? PJ_FWD : PJ_INV;
+  fwd_func = rgeo_kernel_func(kernel, fwd);
+  inv_func = rgeo_kernel_func(kernel, inv);
+  fwd_tolerance = kernel->type == RGEO_KERNEL_IDENTITY
+                      ? RGEO_KERNEL_TOLERANCE_DEGREES
+                      : RGEO_KERNEL_TOLERANCE_METERS;
+  has_inverse = proj_pj_info(pipeline).has_inverse;
+
+  for (i = 0; i < RGEO_KERNEL_SAMPLE_COUNT; i++) {
+    x = rgeo_kernel_samples[i][0];
+    y = rgeo_kernel_samples[i][1];
+    if (kernel->type == RGEO_KERNEL_UTM) {
+      x = x / 60.0 + kernel->lam0 / RGEO_KERNEL_RADIANS_PER_DEGREE;
+    }
+    coord = proj_trans(pipeline, fwd, proj_coord(x, y, 0.0, 0.0));
+    if (!fwd_func(kernel, &x, &y) ||
+        !rgeo_kernel_close(x, y, coord, fwd_tolerance)) {
+      return 0;
+    }
+    if (!has_inverse) {
+      continue;
+    }
+    x = coord.xy.x;
+    y = coord.xy.y;
+    coord = proj_trans(pipeline, inv, coord);
+    if (!inv_func(kernel, &x, &y) ||
+        !rgeo_kernel_close(x, y, coord, RGEO_KERNEL_TOLERANCE_DEGREES)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void rgeo_kernel_detect(RGeo_Kernel *kernel, PJ_CONTEXT *ctx, PJ *source,
+                        PJ *target, PJ *pipeline) {
+  static const char *const geographic[] = {
+      "EPSG:4326", "+proj=longlat +datum=WGS84 +no_defs +type=crs"};
+  // The second one is the definition of Web Mercator used before EPSG:3857,
+  // still common with RGeo::Geographic.projected_factory.
+  static const char *const web_mercator[] = {
+      "EPSG:3857",
+      "+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 "
+      "+y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs +type=crs"};
+  RGeo_KernelReferences *references;
+  PJ *projected;
+  int zone;
+  int south;
+
+  kernel->type = RGEO_KERNEL_NONE;
+  kernel->inverse = 0;
+  if (!kernels_enabled || !source || !target || !pipeline) {
+    return;
+  }
+
+  if (proj_is_equivalent_to(source, target, PJ_COMP_EQUIVALENT)) {
+    kernel->type = RGEO_KERNEL_IDENTITY;
+  } else {
+    references = rgeo_kernel_references(ctx);
+    if (rgeo_kernel_crs_matches(ctx, source, references->geographic,
+                                geographic,
+                                PJ_COMP_EQUIVALENT_EXCEPT_AXIS_ORDER_GEOGCRS)) {
+      projected = target;
+    } else if (rgeo_kernel_crs_matches(
+                   ctx, target, references->geographic, geographic,
+                   PJ_COMP_EQUIVALENT_EXCEPT_AXIS_ORDER_GEOGCRS)) {
+      projected = source;
+      kernel->inverse = 1;
+    } else {
+      return;
+    }
+    if (rgeo_kernel_crs_matches(ctx, projected, references->web_mercator,
+                                web_mercator, PJ_COMP_EQUIVALENT)) {
+      kernel->type = RGEO_KERNEL_WEB_MERCATOR;
+    } else if ((zone = rgeo_kernel_utm_zone(ctx, references, projected,
+                                            &south)) != 0) {
+      rgeo_kernel_utm_init(kernel, zone, south);
+    } else {
+      return;
+    }
+  }
+
+  // A pipeline keeping several candidate operations is checked against the
+  // one PROJ picks for each sample, and never gets a kernel when they differ.
+  if (!rgeo_kernel_verify(kernel, pipeline)) {
+    kernel->type = RGEO_KERNEL_NONE;
+  }
+}
+
+static VALUE cmethod_fast_paths(VALUE klass) {
+  return kernels_enabled ? Qtrue : Qfalse;
+}
+
+static VALUE cmethod_set_fast_paths(VALUE klass, VALUE enabled) {
+  kernels_enabled = RTEST(enabled);
+  return enabled;
+}
+
+void rgeo_init_proj_kernels() {
+  VALUE rgeo_module;
+  VALUE coordsys_module;
+  VALUE crs_to_crs_class;
+
+  kernel_references = NULL;
+  rb_nativethread_lock_initialize(&kernel_references_lock);
+
+  rgeo_module = rb_define_module("RGeo");
+  coordsys_module = rb_define_module_under(rgeo_module, "CoordSys");
+  crs_to_crs_class = rb_const_get(coordsys_module, rb_intern("CRSToCRS"));
+  rb_define_module_function(crs_to_crs_class, "_fast_paths",
+                            cmethod_fast_paths, 0);
+  rb_define_module_function(crs_to_crs_class, "_set_fast_paths",
+                            cmethod_set_fast_paths, 1);
+}
+
+RGEO_END_C
+
+#endif // RGEO_PROJ4_SUPPORTED
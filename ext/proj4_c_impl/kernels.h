@@ -0,0 +1,83 @@
+#ifndef RGEO_PROJ4_KERNELS_INCLUDED
+#define RGEO_PROJ4_KERNELS_INCLUDED
+
+#include <ruby.h>
+
+#ifdef RGEO_PROJ4_SUPPORTED
+
+#include <proj.h>
+
+RGEO_BEGIN_C
+
+// Largest differences allowed between a kernel and the pipeline it replaces,
+// checked when the kernel is picked: in meters for projected coordinates and
+// in degrees for geographic ones.
+#define RGEO_KERNEL_TOLERANCE_METERS 1e-6
+#define RGEO_KERNEL_TOLERANCE_DEGREES 1e-11
+
+// Order of the series of the transverse Mercator kernel.
+#define RGEO_KERNEL_TMERC_ORDER 6
+
+typedef enum {
+  RGEO_KERNEL_NONE,
+  // Source and target are equivalent, coordinates are left as they are.
+  RGEO_KERNEL_IDENTITY,
+  // WGS 84 longitude and latitude to and from Web Mercator (EPSG:3857).
+  RGEO_KERNEL_WEB_MERCATOR,
+  // WGS 84 longitude and latitude to and from a WGS 84 / UTM zone
+  // (EPSG:32601 to 32660 and EPSG:32701 to 32760).
+  RGEO_KERNEL_UTM
+} RGeo_KernelType;
+
+// Closed-form transform replacing a pipeline between well-known CRSs, that
+// skips the generic machinery PROJ runs for each coordinate.
+typedef struct {
+  RGeo_KernelType type;
+  // Set when the pipeline runs from the projected CRS to the geographic one.
+  char inverse;
+  // UTM zone, central meridian in radians and false northing.
+  int zone;
+  double lam0;
+  double y0;
+  // Poder/Engsager transverse Mercator constants, as in PROJ: normalized
+  // meridian quadrant and coefficients of the series between geodetic and
+  // Gaussian latitudes (cgb, cbg) and between the ellipsoidal and spherical
+  // coordinates (utg, gtu).
+  double qn;
+  double cgb[RGEO_KERNEL_TMERC_ORDER];
+  double cbg[RGEO_KERNEL_TMERC_ORDER];
+  double utg[RGEO_KERNEL_TMERC_ORDER];
+  double gtu[RGEO_KERNEL_TMERC_ORDER];
+} RGeo_Kernel;
+
+// Transforms the point at x, y in place, in degrees on the geographic side.
+// Returns 0, leaving the point untouched, when it is outside of the domain
+// the kernel handles and must be left to PROJ. Safe to call without the GVL.
+typedef int (*RGeo_KernelFunc)(const RGeo_Kernel *kernel, double *x,
+                               double *y);
+
+// Picks the kernel for pipeline, created from source to target and bound to
+// ctx, a context leased by the caller, or RGEO_KERNEL_NONE. A kernel is only
+// picked when it agrees with pipeline on sample points in both directions,
+// within the tolerances above, and when enabled with
+// CRSToCRS.fast_paths = true (the default). The reference CRSs compared with
+// source and target are created once per context. Must be called with the
+// GVL held.
+void rgeo_kernel_detect(RGeo_Kernel *kernel, PJ_CONTEXT *ctx, PJ *source,
+                        PJ *target, PJ *pipeline);
+
+// Returns the function running kernel in direction, relative to the
+// pipeline it replaces, or NULL for RGEO_KERNEL_NONE.
+RGeo_KernelFunc rgeo_kernel_func(const RGeo_Kernel *kernel,
+                                 PJ_DIRECTION direction);
+
+// Returns the name of the kernel, or NULL for RGEO_KERNEL_NONE.
+const char *rgeo_kernel_name(const RGeo_Kernel *kernel);
+
+void rgeo_init_proj_kernels();
+
+RGEO_END_C
+
+#endif // RGEO_PROJ4_SUPPORTED
+
+#endif // RGEO_PROJ4_KERNELS_INCLUDED
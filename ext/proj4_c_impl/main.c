@@ -6,9 +6,26 @@
 
 #ifdef RGEO_PROJ4_SUPPORTED
 
+#include "approx.h"
+#include "arrow.h"
+#include "context.h"
 #include "errors.h"
+#include "kernels.h"
+#include "stats.h"
+#include "wkb.h"
+#include "workers.h"
 #include <proj.h>
 #include <ruby.h>
+#include <ruby/encoding.h>
+#include <ruby/thread.h>
+#include <ruby/thread_native.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_RB_IO_BUFFER_GET_BYTES_FOR_WRITING
+#include <ruby/io/buffer.h>
+#endif
 
 #endif
 
@@ -22,55 +39,188 @@ RGEO_BEGIN_C
 #define WKT_TYPE PJ_WKT2_2019
 #endif
 
+#define RGEO_DEGREES_PER_RADIAN (180.0 / 3.14159265358979323846)
+
+// Native data is immutable once created and every PROJ call goes through a
+// leased context, so frozen objects can be shared between Ractors.
+#ifdef RUBY_TYPED_FROZEN_SHAREABLE
+#define RGEO_TYPED_FROZEN_SHAREABLE RUBY_TYPED_FROZEN_SHAREABLE
+#else
+#define RGEO_TYPED_FROZEN_SHAREABLE 0
+#endif
+
+// PJ of a Proj4, shared by the copies made of it with dup, clone or Marshal
+// and YAML loads, and destroyed with the last of them.
+typedef struct {
+  PJ *pj;
+  size_t refs;
+} RGeo_PJRef;
+
 typedef struct {
+  // pj is pj_ref->pj, or NULL.
   PJ *pj;
+  RGeo_PJRef *pj_ref;
   VALUE original_str;
   char uses_radians;
+  // Cleared for a Proj4 created lazily, until pj is created from
+  // original_str on first use. The fields below are only valid once set.
+  char resolved;
+  // Canonical PROJ string of pj, and a hash of it and uses_radians. Both are
+  // computed once when pj is set, and back Proj4#hash and Proj4#eql?.
+  VALUE canonical_str;
+  st_index_t fingerprint;
+  // Metadata computed once when pj is set. axes is a frozen Array of frozen
+  // [name, unit] pairs, and axis_count is -1 when pj has no coordinate
+  // system.
+  PJ_TYPE type;
+  int axis_count;
+  VALUE axes;
+  VALUE auth_name;
 } RGeo_Proj4Data;
 
-typedef struct {
+// Copy of a CRSToCRS pipeline bound to one of the pooled contexts, so that
+// it can be used outside of the GVL at the same time as the other copies.
+typedef struct RGeo_PJClone {
+  PJ_CONTEXT *ctx;
+  PJ *pj;
+  struct RGeo_PJClone *next;
+} RGeo_PJClone;
+
+typedef struct RGeo_CRSToCRSData {
   PJ *crs_to_crs;
+  RGeo_PJClone *clones;
+  size_t clone_count;
+  rb_nativethread_lock_t clones_lock;
+  // Held while crs_to_crs itself runs, bound to the context of the caller,
+  // when no copy of it can be made. Ractors do not share the GVL.
+  rb_nativethread_lock_t shared_lock;
+  // Direction in which crs_to_crs is run. An inverse CRSToCRS runs the
+  // pipeline of the CRSToCRS it was made from, kept alive in base, and
+  // leases the clones of its owner.
+  PJ_DIRECTION direction;
+  char invertible;
+  // Set when the source or target is a geographic CRS whose coordinates are
+  // in radians. Pipelines work in degrees, so coordinates are scaled before
+  // and after running them.
+  char from_radians;
+  char to_radians;
+  VALUE base;
+  struct RGeo_CRSToCRSData *owner;
+  // Grid interpolating the pipeline over an area, used instead of it for
+  // 2D coordinates the grid covers, or NULL.
+  RGeo_ApproxGrid *approx;
+  // Closed-form replacement of the pipeline, picked when it is created.
+  RGeo_Kernel kernel;
 } RGeo_CRSToCRSData;
 
-// PROJ context for multithreaded environments. This avoids segfaults or
-// hanging processes on fork. We only use one context, initialized on load.
-static PJ_CONTEXT *local_proj_context;
+// Pipeline leased for a single transformation from owner. When shared is
+// set, pj is the CRSToCRS pipeline itself and must only be used with the GVL
+// held, between rgeo_crs_to_crs_bind and rgeo_crs_to_crs_unbind.
+typedef struct {
+  RGeo_CRSToCRSData *owner;
+  PJ_CONTEXT *ctx;
+  PJ *pj;
+  char shared;
+} RGeo_PJLease;
+
+// proj_as_wkt and proj_as_proj_string cache their result inside the PJ, so
+// exports of an object shared between Ractors must not overlap.
+static rb_nativethread_lock_t export_lock;
+
+// Guards the resolution of lazy Proj4 objects and the reference counts of
+// shared PJs, as Proj4 objects and their copies may live in different
+// Ractors.
+static rb_nativethread_lock_t proj4_lock;
+
+// Takes ownership of pj, which may be NULL, as the PJ of data.
+static void rgeo_proj4_set_pj(RGeo_Proj4Data *data, PJ *pj) {
+  data->pj = pj;
+  data->pj_ref = NULL;
+  if (pj) {
+    data->pj_ref = ALLOC(RGeo_PJRef);
+    data->pj_ref->pj = pj;
+    data->pj_ref->refs = 1;
+  }
+}
+
+// Drops the reference of data to its PJ, destroying it if it was the last.
+static void rgeo_proj4_release_pj(RGeo_Proj4Data *data) {
+  RGeo_PJRef *ref;
+  size_t refs;
+
+  ref = data->pj_ref;
+  data->pj = NULL;
+  data->pj_ref = NULL;
+  if (!ref) {
+    return;
+  }
+  rb_nativethread_lock_lock(&proj4_lock);
+  refs = --ref->refs;
+  rb_nativethread_lock_unlock(&proj4_lock);
+  if (refs == 0) {
+    proj_destroy(ref->pj);
+    FREE(ref);
+  }
+}
 
 // Destroy function for proj data.
 static void rgeo_proj4_free(void *ptr) {
   RGeo_Proj4Data *data = (RGeo_Proj4Data *)ptr;
-  if (data->pj) {
-    proj_destroy(data->pj);
-  }
+  rgeo_proj4_release_pj(data);
   FREE(data);
 }
 
 // Destroy function for crs_to_crs data.
 static void rgeo_crs_to_crs_free(void *ptr) {
   RGeo_CRSToCRSData *data = (RGeo_CRSToCRSData *)ptr;
-  if (data->crs_to_crs) {
+  RGeo_PJClone *clone;
+
+  while (data->clones) {
+    clone = data->clones;
+    data->clones = clone->next;
+    proj_destroy(clone->pj);
+    FREE(clone);
+  }
+  rb_nativethread_lock_destroy(&data->clones_lock);
+  rb_nativethread_lock_destroy(&data->shared_lock);
+  if (data->crs_to_crs && data->owner == data) {
     proj_destroy(data->crs_to_crs);
   }
+  rgeo_approx_free(data->approx);
   FREE(data);
 }
 
+// PROJ does not report the memory held by its objects. These are rough
+// estimates of a CRS and of a pipeline with its candidate operations, so that
+// ObjectSpace.memsize_of reflects the native allocations.
+#define RGEO_PJ_CRS_MEMSIZE (16 * 1024)
+#define RGEO_PJ_PIPELINE_MEMSIZE (64 * 1024)
+
 static size_t rgeo_proj4_memsize(const void *ptr) {
   size_t size = 0;
   const RGeo_Proj4Data *data = (const RGeo_Proj4Data *)ptr;
 
   size += sizeof(*data);
+  // A PJ shared between copies is counted by each of them.
   if (data->pj) {
-    size += sizeof(data->pj);
+    size += sizeof(RGeo_PJRef) + RGEO_PJ_CRS_MEMSIZE;
   }
   return size;
 }
 
+// The pipeline and its clones are counted by the CRSToCRS owning them, not by
+// its inverses.
 static size_t rgeo_crs_to_crs_memsize(const void *ptr) {
   size_t size = 0;
   const RGeo_CRSToCRSData *data = (const RGeo_CRSToCRSData *)ptr;
   size += sizeof(*data);
-  if (data->crs_to_crs) {
-    size += sizeof(data->crs_to_crs);
+  if (data->crs_to_crs && data->owner == data) {
+    size += RGEO_PJ_PIPELINE_MEMSIZE;
+    size += data->clone_count *
+            (sizeof(RGeo_PJClone) + RGEO_PJ_PIPELINE_MEMSIZE);
+  }
+  if (data->approx) {
+    size += rgeo_approx_memsize(data->approx);
   }
   return size;
 }
@@ -80,23 +230,66 @@ static void rgeo_proj4_mark(void *ptr) {
   if (!NIL_P(data->original_str)) {
     mark(data->original_str);
   }
+  if (!NIL_P(data->canonical_str)) {
+    mark(data->canonical_str);
+  }
+  if (!NIL_P(data->axes)) {
+    mark(data->axes);
+  }
+  if (!NIL_P(data->auth_name)) {
+    mark(data->auth_name);
+  }
+}
+
+static void rgeo_crs_to_crs_mark(void *ptr) {
+  RGeo_CRSToCRSData *data = (RGeo_CRSToCRSData *)ptr;
+  if (!NIL_P(data->base)) {
+    mark(data->base);
+  }
 }
 
 #ifdef HAVE_RB_GC_MARK_MOVABLE
+static void rgeo_crs_to_crs_compact(void *ptr) {
+  RGeo_CRSToCRSData *data = (RGeo_CRSToCRSData *)ptr;
+  if (data && !NIL_P(data->base)) {
+    data->base = rb_gc_location(data->base);
+  }
+}
+
 static void rgeo_proj4_compact(void *ptr) {
   RGeo_Proj4Data *data = (RGeo_Proj4Data *)ptr;
   if (data && !NIL_P(data->original_str)) {
     data->original_str = rb_gc_location(data->original_str);
   }
+  if (data && !NIL_P(data->canonical_str)) {
+    data->canonical_str = rb_gc_location(data->canonical_str);
+  }
+  if (data && !NIL_P(data->axes)) {
+    data->axes = rb_gc_location(data->axes);
+  }
+  if (data && !NIL_P(data->auth_name)) {
+    data->auth_name = rb_gc_location(data->auth_name);
+  }
 }
 #endif
 
+static void rgeo_proj4_init_struct(RGeo_Proj4Data *data) {
+  data->pj = NULL;
+  data->pj_ref = NULL;
+  data->original_str = Qnil;
+  data->uses_radians = 0;
+  data->resolved = 1;
+  data->canonical_str = Qnil;
+  data->fingerprint = 0;
+  data->type = PJ_TYPE_UNKNOWN;
+  data->axis_count = -1;
+  data->axes = Qnil;
+  data->auth_name = Qnil;
+}
+
 static void rgeo_proj4_clear_struct(RGeo_Proj4Data *data) {
-  if (data->pj) {
-    proj_destroy(data->pj);
-    data->pj = NULL;
-    data->original_str = Qnil;
-  }
+  rgeo_proj4_release_pj(data);
+  rgeo_proj4_init_struct(data);
 }
 
 static const rb_data_type_t rgeo_proj4_data_type = {
@@ -108,14 +301,18 @@ static const rb_data_type_t rgeo_proj4_data_type = {
     },
     0,
     0,
-    RUBY_TYPED_FREE_IMMEDIATELY};
+    RUBY_TYPED_FREE_IMMEDIATELY | RGEO_TYPED_FROZEN_SHAREABLE};
 
 static const rb_data_type_t rgeo_crs_to_crs_data_type = {
     "RGeo::CoordSys::CRSToCRS",
-    {0, rgeo_crs_to_crs_free, rgeo_crs_to_crs_memsize},
+    {rgeo_crs_to_crs_mark, rgeo_crs_to_crs_free, rgeo_crs_to_crs_memsize,
+#ifdef HAVE_RB_GC_MARK_MOVABLE
+     rgeo_crs_to_crs_compact
+#endif
+    },
     0,
     0,
-    RUBY_TYPED_FREE_IMMEDIATELY};
+    RUBY_TYPED_FREE_IMMEDIATELY | RGEO_TYPED_FROZEN_SHAREABLE};
 
 static VALUE rgeo_proj4_data_alloc(VALUE self) {
   VALUE result;
@@ -124,14 +321,29 @@ static VALUE rgeo_proj4_data_alloc(VALUE self) {
   result = Qnil;
 
   if (data) {
-    data->pj = NULL;
-    data->original_str = Qnil;
-    data->uses_radians = 0;
+    rgeo_proj4_init_struct(data);
     result = TypedData_Wrap_Struct(self, &rgeo_proj4_data_type, data);
   }
   return result;
 }
 
+static void rgeo_crs_to_crs_data_init(RGeo_CRSToCRSData *data, PJ *pj) {
+  data->crs_to_crs = pj;
+  data->clones = NULL;
+  data->clone_count = 0;
+  rb_nativethread_lock_initialize(&data->clones_lock);
+  rb_nativethread_lock_initialize(&data->shared_lock);
+  data->direction = PJ_FWD;
+  data->invertible = 0;
+  data->from_radians = 0;
+  data->to_radians = 0;
+  data->base = Qnil;
+  data->owner = data;
+  data->approx = NULL;
+  data->kernel.type = RGEO_KERNEL_NONE;
+  data->kernel.inverse = 0;
+}
+
 static VALUE rgeo_crs_to_crs_data_alloc(VALUE self) {
   VALUE result;
   RGeo_CRSToCRSData *data = ALLOC(RGeo_CRSToCRSData);
@@ -139,50 +351,228 @@ static VALUE rgeo_crs_to_crs_data_alloc(VALUE self) {
   result = Qnil;
 
   if (data) {
-    data->crs_to_crs = NULL;
+    rgeo_crs_to_crs_data_init(data, NULL);
     result = TypedData_Wrap_Struct(self, &rgeo_crs_to_crs_data_type, data);
   }
   return result;
 }
 
-static VALUE method_proj4_initialize_copy(VALUE self, VALUE orig) {
-  RGeo_Proj4Data *self_data;
-  RGeo_Proj4Data *orig_data;
+typedef enum {
+  RGEO_EXPORT_PROJ_STRING,
+  RGEO_EXPORT_WKT,
+  RGEO_EXPORT_PROJJSON
+} RGeo_ExportFormat;
+
+// Initial size of the buffer rgeo_pj_export_str copies exports into, enough
+// for most WKT definitions.
+#define RGEO_EXPORT_BUFFER_SIZE 4096
+
+// Exports pj as a one-line PROJ string, WKT or PROJJSON, or returns nil when
+// PROJ cannot export it or exports nothing. The result is copied out of the
+// PJ before the export lock is released, into a buffer allocated beforehand
+// since allocating while holding a native lock could deadlock with a GC
+// barrier. Longer exports are run again once the buffer is grown.
+static VALUE rgeo_pj_export_str(const PJ *pj, RGeo_ExportFormat format) {
+  const char *const options[] = {"MULTILINE=NO", NULL};
+  VALUE result;
+  PJ_CONTEXT *ctx;
   const char *str;
+  char *copy;
+  size_t capacity;
+  size_t len;
+
+  capacity = RGEO_EXPORT_BUFFER_SIZE;
+  copy = ALLOC_N(char, capacity);
+  for (;;) {
+    ctx = rgeo_proj_context_acquire();
+    rb_nativethread_lock_lock(&export_lock);
+    switch (format) {
+    case RGEO_EXPORT_WKT:
+      str = proj_as_wkt(ctx, pj, WKT_TYPE, options);
+      break;
+    case RGEO_EXPORT_PROJJSON:
+      str = proj_as_projjson(ctx, pj, options);
+      break;
+    default:
+      str = proj_as_proj_string(ctx, pj, PJ_PROJ_4, NULL);
+      break;
+    }
+    len = str ? strlen(str) : 0;
+    if (len > 0 && len <= capacity) {
+      memcpy(copy, str, len);
+    }
+    rb_nativethread_lock_unlock(&export_lock);
+    rgeo_proj_context_release(ctx);
+    if (len <= capacity) {
+      break;
+    }
+    capacity = len;
+    REALLOC_N(copy, char, capacity);
+  }
 
-  // Clear out any existing value
-  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, self_data);
-  rgeo_proj4_clear_struct(self_data);
+  result = len > 0 ? rb_str_new(copy, len) : Qnil;
+  FREE(copy);
+  return result;
+}
 
-  // Copy value from orig
-  TypedData_Get_Struct(orig, RGeo_Proj4Data, &rgeo_proj4_data_type, orig_data);
-  if (!NIL_P(orig_data->original_str)) {
-    self_data->pj = proj_create(local_proj_context,
-                                StringValuePtr(orig_data->original_str));
-  } else {
-    str =
-        proj_as_proj_string(local_proj_context, orig_data->pj, PJ_PROJ_4, NULL);
-    self_data->pj = proj_create(local_proj_context, str);
+// Creates a PJ from a definition on a leased context.
+static PJ *rgeo_pj_create(const char *definition) {
+  PJ_CONTEXT *ctx;
+  PJ *pj;
+  size_t started;
+
+  started = rgeo_stats_clock();
+  ctx = rgeo_proj_context_acquire();
+  pj = proj_create(ctx, definition);
+  rgeo_proj_context_release(ctx);
+  rgeo_stats_add(RGEO_STAT_CRS_CREATED, 1);
+  rgeo_stats_add(RGEO_STAT_CRS_CREATE_TIME, rgeo_stats_clock() - started);
+  if (!pj) {
+    rgeo_stats_add(RGEO_STAT_PROJ_ERRORS, 1);
   }
-  self_data->original_str = orig_data->original_str;
-  self_data->uses_radians = orig_data->uses_radians;
+  return pj;
+}
 
-  return self;
+// Computes the canonical string and fingerprint of a Proj4, once its pj and
+// uses_radians are set. Equivalent definitions written differently, such as
+// an authority code and the matching PROJ string, share a canonical string.
+static void rgeo_proj4_fingerprint(RGeo_Proj4Data *data) {
+  VALUE str;
+  st_index_t hash;
+
+  str = Qnil;
+  if (data->pj) {
+    str = rgeo_pj_export_str(data->pj, RGEO_EXPORT_PROJ_STRING);
+  }
+  hash = rb_hash_start(data->uses_radians);
+  if (!NIL_P(str)) {
+    rb_enc_associate(str, rb_usascii_encoding());
+    rb_obj_freeze(str);
+    hash = rb_hash_uint(hash, rb_str_hash(str));
+  }
+  data->canonical_str = str;
+  data->fingerprint = rb_hash_end(hash);
+}
+
+// Computes the canonical string, fingerprint and metadata of a Proj4 once
+// its pj and uses_radians are set, so that later queries about its type,
+// axes and authority do not go back to PROJ.
+static void rgeo_proj4_describe(RGeo_Proj4Data *data) {
+  PJ_CONTEXT *ctx;
+  PJ *pj_cs;
+  const char *auth;
+  const char *code;
+  const char *name;
+  const char *unit;
+  VALUE axis;
+  int i;
+
+  rgeo_proj4_fingerprint(data);
+  data->resolved = 1;
+  data->type = PJ_TYPE_UNKNOWN;
+  data->axis_count = -1;
+  data->axes = Qnil;
+  data->auth_name = Qnil;
+  if (!data->pj) {
+    return;
+  }
+
+  data->type = proj_get_type(data->pj);
+  auth = proj_get_id_auth_name(data->pj, 0);
+  code = proj_get_id_code(data->pj, 0);
+  if (auth && code) {
+    data->auth_name = rb_obj_freeze(rb_sprintf("%s:%s", auth, code));
+  }
+
+  ctx = rgeo_proj_context_acquire();
+  pj_cs = proj_crs_get_coordinate_system(ctx, data->pj);
+  if (pj_cs) {
+    data->axis_count = proj_cs_get_axis_count(ctx, pj_cs);
+    data->axes = rb_ary_new();
+    for (i = 0; i < data->axis_count; i++) {
+      if (!proj_cs_get_axis_info(ctx, pj_cs, i, &name, NULL, NULL, NULL,
+                                 &unit, NULL, NULL)) {
+        break;
+      }
+      axis = rb_ary_new_from_args(2, rb_obj_freeze(rb_str_new_cstr(name)),
+                                  rb_obj_freeze(rb_str_new_cstr(unit)));
+      rb_ary_push(data->axes, rb_obj_freeze(axis));
+    }
+    rb_obj_freeze(data->axes);
+    proj_destroy(pj_cs);
+  }
+  rgeo_proj_context_release(ctx);
+}
+
+// Creates the pj of a Proj4 made lazily, on first use. Ractors sharing it
+// may race to do so, in which case the first one to finish wins and the
+// others discard their work.
+static void rgeo_proj4_resolve(RGeo_Proj4Data *data) {
+  RGeo_Proj4Data resolved;
+  char done;
+
+  rb_nativethread_lock_lock(&proj4_lock);
+  done = data->resolved;
+  rb_nativethread_lock_unlock(&proj4_lock);
+  if (done) {
+    return;
+  }
+
+  rgeo_proj4_init_struct(&resolved);
+  resolved.original_str = data->original_str;
+  resolved.uses_radians = data->uses_radians;
+  rgeo_proj4_set_pj(&resolved, rgeo_pj_create(RSTRING_PTR(data->original_str)));
+  rgeo_proj4_describe(&resolved);
+
+  rb_nativethread_lock_lock(&proj4_lock);
+  if (!data->resolved) {
+    *data = resolved;
+    resolved.pj = NULL;
+    resolved.pj_ref = NULL;
+  }
+  rb_nativethread_lock_unlock(&proj4_lock);
+  rgeo_proj4_release_pj(&resolved);
+  RB_GC_GUARD(resolved.canonical_str);
+  RB_GC_GUARD(resolved.axes);
+  RB_GC_GUARD(resolved.auth_name);
+}
+
+// Returns the data of a Proj4, creating its pj first if it was made lazily.
+static RGeo_Proj4Data *rgeo_proj4_get(VALUE self) {
+  RGeo_Proj4Data *data;
+
+  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, data);
+  rgeo_proj4_resolve(data);
+  return data;
 }
 
-static VALUE method_proj4_set_value(VALUE self, VALUE str, VALUE uses_radians) {
+// Makes self a copy of orig, sharing its PJ and metadata. A copy of a lazy
+// Proj4 is lazy as well, and creates its own PJ on first use.
+static VALUE method_proj4_initialize_copy(VALUE self, VALUE orig) {
   RGeo_Proj4Data *self_data;
+  RGeo_Proj4Data *orig_data;
 
-  Check_Type(str, T_STRING);
+  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, self_data);
+  TypedData_Get_Struct(orig, RGeo_Proj4Data, &rgeo_proj4_data_type, orig_data);
+  if (self_data == orig_data) {
+    return self;
+  }
 
   // Clear out any existing value
-  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, self_data);
   rgeo_proj4_clear_struct(self_data);
 
-  // Set new data
-  self_data->pj = proj_create(local_proj_context, StringValuePtr(str));
-  self_data->original_str = str;
-  self_data->uses_radians = RTEST(uses_radians) ? 1 : 0;
+  rb_nativethread_lock_lock(&proj4_lock);
+  if (orig_data->resolved) {
+    *self_data = *orig_data;
+    if (self_data->pj_ref) {
+      self_data->pj_ref->refs++;
+    }
+  } else {
+    self_data->original_str = orig_data->original_str;
+    self_data->uses_radians = orig_data->uses_radians;
+    self_data->resolved = 0;
+  }
+  rb_nativethread_lock_unlock(&proj4_lock);
 
   return self;
 }
@@ -191,16 +581,17 @@ static VALUE method_proj4_get_geographic(VALUE self) {
   VALUE result;
   RGeo_Proj4Data *new_data;
   RGeo_Proj4Data *self_data;
+  PJ_CONTEXT *ctx;
   PJ *geographic_proj;
 
   result = Qnil;
   new_data = ALLOC(RGeo_Proj4Data);
   if (new_data) {
-    TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type,
-                         self_data);
+    self_data = rgeo_proj4_get(self);
 
-    geographic_proj =
-        proj_crs_get_geodetic_crs(local_proj_context, self_data->pj);
+    ctx = rgeo_proj_context_acquire();
+    geographic_proj = proj_crs_get_geodetic_crs(ctx, self_data->pj);
+    rgeo_proj_context_release(ctx);
     if (geographic_proj == 0) {
       FREE(new_data);
       rb_raise(rb_eRGeoInvalidProjectionError,
@@ -208,11 +599,12 @@ static VALUE method_proj4_get_geographic(VALUE self) {
                "projection is not a CRS");
     }
 
-    new_data->pj = geographic_proj;
-    new_data->original_str = Qnil;
+    rgeo_proj4_init_struct(new_data);
+    rgeo_proj4_set_pj(new_data, geographic_proj);
     new_data->uses_radians = self_data->uses_radians;
     result =
         TypedData_Wrap_Struct(CLASS_OF(self), &rgeo_proj4_data_type, new_data);
+    rgeo_proj4_describe(new_data);
   }
   return result;
 }
@@ -223,277 +615,2728 @@ static VALUE method_proj4_original_str(VALUE self) {
   return data->original_str;
 }
 
+// Sets the definition reported by original_str, for a copy handed out by
+// Proj4.create for a definition spelled differently.
+static VALUE method_proj4_set_original_str(VALUE self, VALUE str) {
+  RGeo_Proj4Data *data;
+
+  rb_check_frozen(self);
+  Check_Type(str, T_STRING);
+  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, data);
+  data->original_str = rb_str_new_frozen(str);
+  return str;
+}
+
 static VALUE method_proj4_uses_radians(VALUE self) {
   RGeo_Proj4Data *data;
   TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, data);
   return data->uses_radians ? Qtrue : Qfalse;
 }
 
+// Returns a copy of the canonical string, which copies of the Proj4 share.
 static VALUE method_proj4_canonical_str(VALUE self) {
-  VALUE result;
-  PJ *pj;
-  const char *str;
   RGeo_Proj4Data *data;
+  data = rgeo_proj4_get(self);
+  return NIL_P(data->canonical_str) ? Qnil : rb_str_dup(data->canonical_str);
+}
 
-  result = Qnil;
-  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, data);
-  pj = data->pj;
-  if (pj) {
-    str = proj_as_proj_string(local_proj_context, pj, PJ_PROJ_4, NULL);
-    if (str) {
-      result = rb_str_new2(str);
-    }
+static VALUE method_proj4_fingerprint(VALUE self) {
+  RGeo_Proj4Data *data;
+  data = rgeo_proj4_get(self);
+  return ST2FIX(data->fingerprint);
+}
+
+// Two Proj4 are equal when their fingerprints match and they have the same
+// canonical string.
+static VALUE method_proj4_eql(VALUE self, VALUE other) {
+  RGeo_Proj4Data *self_data;
+  RGeo_Proj4Data *other_data;
+
+  self_data = rgeo_proj4_get(self);
+  other_data = rgeo_proj4_get(other);
+  if (self_data == other_data) {
+    return Qtrue;
   }
-  return result;
+  if (self_data->fingerprint != other_data->fingerprint ||
+      self_data->uses_radians != other_data->uses_radians) {
+    return Qfalse;
+  }
+  if (!NIL_P(self_data->canonical_str) && !NIL_P(other_data->canonical_str) &&
+      rb_str_equal(self_data->canonical_str, other_data->canonical_str)) {
+    return Qtrue;
+  }
+  return Qfalse;
 }
 
 static VALUE method_proj4_wkt_str(VALUE self) {
   VALUE result;
   PJ *pj;
-  const char *str;
   RGeo_Proj4Data *data;
 
   result = Qnil;
-  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, data);
+  data = rgeo_proj4_get(self);
   pj = data->pj;
   if (pj) {
-    const char *const options[] = {"MULTILINE=NO", NULL};
-    str = proj_as_wkt(local_proj_context, pj, WKT_TYPE, options);
-    if (str) {
-      result = rb_str_new2(str);
-    }
+    result = rgeo_pj_export_str(pj, RGEO_EXPORT_WKT);
   }
   return result;
 }
 
 static VALUE method_proj4_auth_name_str(VALUE self) {
-  VALUE result;
-  PJ *pj;
-  const char *id;
-  const char *auth;
   RGeo_Proj4Data *data;
-
-  result = Qnil;
-  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, data);
-  pj = data->pj;
-  if (pj) {
-    auth = proj_get_id_auth_name(pj, 0);
-    id = proj_get_id_code(pj, 0);
-    if (id && auth) {
-      result = rb_sprintf("%s:%s", auth, id);
-    }
-  }
-  return result;
+  data = rgeo_proj4_get(self);
+  return data->auth_name;
 }
 
-static VALUE method_proj4_axis_and_unit_info_str(VALUE self, VALUE dimension) {
-  VALUE result;
-  int dimension_index;
-  PJ *pj;
-  PJ *pj_cs;
-  const char *axis_info;
-  const char *unit_name;
+// Returns the [name, unit] pair describing an axis, or nil.
+static VALUE method_proj4_axis_and_unit_info(VALUE self, VALUE dimension) {
   RGeo_Proj4Data *data;
 
   Check_Type(dimension, T_FIXNUM);
-
-  dimension_index = FIX2INT(dimension);
-  result = Qnil;
-
-  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, data);
-  pj = data->pj;
-  if (pj) {
-    pj_cs = proj_crs_get_coordinate_system(local_proj_context, pj);
-    if (pj_cs) {
-      if (proj_cs_get_axis_info(local_proj_context, pj_cs, dimension_index,
-                                &axis_info, NULL, NULL, NULL, &unit_name, NULL,
-                                NULL)) {
-        result = rb_sprintf("%s:%s", axis_info, unit_name);
-      }
-
-      proj_destroy(pj_cs);
-    }
+  data = rgeo_proj4_get(self);
+  if (NIL_P(data->axes)) {
+    return Qnil;
   }
-  return result;
+  return rb_ary_entry(data->axes, FIX2LONG(dimension));
 }
 
 static VALUE method_proj4_axis_count(VALUE self) {
-  VALUE result;
-  PJ *pj;
-  PJ *pj_cs;
-  int count;
   RGeo_Proj4Data *data;
-
-  result = Qnil;
-  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, data);
-  pj = data->pj;
-  if (pj) {
-    pj_cs = proj_crs_get_coordinate_system(local_proj_context, pj);
-    if (pj_cs) {
-      count = proj_cs_get_axis_count(local_proj_context, pj_cs);
-      result = INT2FIX(count);
-
-      proj_destroy(pj_cs);
-    }
-  }
-  return result;
+  data = rgeo_proj4_get(self);
+  return data->axis_count >= 0 ? INT2FIX(data->axis_count) : Qnil;
 }
 
 static VALUE method_proj4_is_geographic(VALUE self) {
-  VALUE result;
-  PJ *pj;
-  PJ_TYPE proj_type;
   RGeo_Proj4Data *data;
 
-  result = Qnil;
-  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, data);
-  pj = data->pj;
-  if (pj) {
-    proj_type = proj_get_type(pj);
-    if (proj_type == PJ_TYPE_GEOGRAPHIC_2D_CRS ||
-        proj_type == PJ_TYPE_GEOGRAPHIC_3D_CRS) {
-      result = Qtrue;
-    } else {
-      result = Qfalse;
-    }
+  data = rgeo_proj4_get(self);
+  if (!data->pj) {
+    return Qnil;
   }
-  return result;
+  return data->type == PJ_TYPE_GEOGRAPHIC_2D_CRS ||
+                 data->type == PJ_TYPE_GEOGRAPHIC_3D_CRS
+             ? Qtrue
+             : Qfalse;
 }
 
 static VALUE method_proj4_is_geocentric(VALUE self) {
-  VALUE result;
-  PJ *pj;
-  PJ_TYPE proj_type;
   RGeo_Proj4Data *data;
 
-  result = Qnil;
-  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, data);
-  pj = data->pj;
-  if (pj) {
-    proj_type = proj_get_type(pj);
-    result = proj_type == PJ_TYPE_GEOCENTRIC_CRS ? Qtrue : Qfalse;
+  data = rgeo_proj4_get(self);
+  if (!data->pj) {
+    return Qnil;
   }
-  return result;
+  return data->type == PJ_TYPE_GEOCENTRIC_CRS ? Qtrue : Qfalse;
 }
 
 static VALUE method_proj4_is_projected(VALUE self) {
-  VALUE result;
-  PJ *pj;
-  PJ_TYPE proj_type;
   RGeo_Proj4Data *data;
 
-  result = Qnil;
-  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, data);
-  pj = data->pj;
-  if (pj) {
-    proj_type = proj_get_type(pj);
-    result = proj_type == PJ_TYPE_PROJECTED_CRS ? Qtrue : Qfalse;
+  data = rgeo_proj4_get(self);
+  if (!data->pj) {
+    return Qnil;
   }
-  return result;
+  return data->type == PJ_TYPE_PROJECTED_CRS ? Qtrue : Qfalse;
 }
 
 static VALUE method_proj4_is_valid(VALUE self) {
   RGeo_Proj4Data *data;
-  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, data);
+  data = rgeo_proj4_get(self);
   return data->pj ? Qtrue : Qfalse;
 }
 
 static VALUE method_proj4_is_crs(VALUE self) {
   RGeo_Proj4Data *self_data;
 
-  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, self_data);
+  self_data = rgeo_proj4_get(self);
   return proj_is_crs(self_data->pj) ? Qtrue : Qfalse;
 }
 
+// Whether the pj of a Proj4 made lazily has been created.
+static VALUE method_proj4_is_resolved(VALUE self) {
+  RGeo_Proj4Data *data;
+  char resolved;
+
+  TypedData_Get_Struct(self, RGeo_Proj4Data, &rgeo_proj4_data_type, data);
+  rb_nativethread_lock_lock(&proj4_lock);
+  resolved = data->resolved;
+  rb_nativethread_lock_unlock(&proj4_lock);
+  return resolved ? Qtrue : Qfalse;
+}
+
 static VALUE cmethod_proj4_version(VALUE module) {
   return rb_sprintf("%d.%d.%d", PROJ_VERSION_MAJOR, PROJ_VERSION_MINOR,
                     PROJ_VERSION_PATCH);
 }
 
-static VALUE cmethod_proj4_create(VALUE klass, VALUE str, VALUE uses_radians) {
+// Returns the path of the proj.db used by PROJ, or nil if none was found.
+static VALUE cmethod_proj4_database_path(VALUE module) {
+  VALUE result;
+  PJ_CONTEXT *ctx;
+  const char *path;
+
+  result = Qnil;
+  ctx = rgeo_proj_context_acquire();
+  path = proj_context_get_database_path(ctx);
+  if (path) {
+    result = rb_str_new_cstr(path);
+  }
+  rgeo_proj_context_release(ctx);
+  return result;
+}
+
+// Returns the directories PROJ searches for grid files, in search order.
+static VALUE cmethod_proj4_search_paths(VALUE module) {
+  VALUE result;
+  PJ_INFO info;
+  size_t i;
+
+  info = proj_info();
+  result = rb_ary_new2(info.path_count);
+  for (i = 0; i < info.path_count; i++) {
+    if (info.paths[i]) {
+      rb_ary_push(result, rb_str_new_cstr(info.paths[i]));
+    }
+  }
+  return result;
+}
+
+// Returns whether PROJ may download the grid files it is missing.
+static VALUE cmethod_proj4_network_enabled(VALUE module) {
+  VALUE result;
+  PJ_CONTEXT *ctx;
+
+  result = Qfalse;
+#if PROJ_VERSION_MAJOR >= 7
+  ctx = rgeo_proj_context_acquire();
+  if (proj_context_is_network_enabled(ctx)) {
+    result = Qtrue;
+  }
+  rgeo_proj_context_release(ctx);
+#else
+  (void)ctx;
+#endif
+  return result;
+}
+
+// Creates a Proj4 from a definition. When lazy is set, the definition is
+// only parsed by PROJ when the Proj4 is first used.
+static VALUE cmethod_proj4_create(VALUE klass, VALUE str, VALUE uses_radians,
+                                  VALUE lazy) {
   VALUE result;
   RGeo_Proj4Data *data;
+  const char *definition;
 
   result = Qnil;
   Check_Type(str, T_STRING);
+  str = rb_str_new_frozen(str);
+  definition = StringValueCStr(str);
   data = ALLOC(RGeo_Proj4Data);
   if (data) {
-    data->pj = proj_create(local_proj_context, StringValuePtr(str));
+    rgeo_proj4_init_struct(data);
     data->original_str = str;
     data->uses_radians = RTEST(uses_radians) ? 1 : 0;
     result = TypedData_Wrap_Struct(klass, &rgeo_proj4_data_type, data);
+    if (RTEST(lazy)) {
+      data->resolved = 0;
+    } else {
+      rgeo_proj4_set_pj(data, rgeo_pj_create(definition));
+      rgeo_proj4_describe(data);
+    }
   }
   return result;
 }
 
-static VALUE cmethod_crs_to_crs_create(VALUE klass, VALUE from, VALUE to) {
-  VALUE result;
-  RGeo_Proj4Data *from_data;
-  RGeo_Proj4Data *to_data;
-  result = Qnil;
-  PJ *from_pj;
-  PJ *to_pj;
-  PJ *gis_pj;
-  PJ *crs_to_crs;
-  RGeo_CRSToCRSData *data;
+// Whether coordinates in the CRS of data are angles in radians.
+static int rgeo_proj4_uses_radians(RGeo_Proj4Data *data) {
+  if (!data->uses_radians || !data->pj) {
+    return 0;
+  }
+  return data->type == PJ_TYPE_GEOGRAPHIC_2D_CRS ||
+         data->type == PJ_TYPE_GEOGRAPHIC_3D_CRS;
+}
 
-  TypedData_Get_Struct(from, RGeo_Proj4Data, &rgeo_proj4_data_type, from_data);
-  TypedData_Get_Struct(to, RGeo_Proj4Data, &rgeo_proj4_data_type, to_data);
-  from_pj = from_data->pj;
-  to_pj = to_data->pj;
-  crs_to_crs = proj_create_crs_to_crs_from_pj(local_proj_context, from_pj,
-                                              to_pj, 0, NULL);
+static void rgeo_crs_to_crs_lease(RGeo_CRSToCRSData *data,
+                                  RGeo_PJLease *lease);
+static void rgeo_crs_to_crs_unlease(RGeo_PJLease *lease);
+static void rgeo_crs_to_crs_bind(RGeo_PJLease *lease);
+static void rgeo_crs_to_crs_unbind(RGeo_PJLease *lease);
 
-  // check for invalid transformation
-  if (crs_to_crs == 0) {
-    rb_raise(rb_eRGeoInvalidProjectionError,
-             "CRSToCRS could not be created from input projections");
-  }
+static VALUE rgeo_crs_to_crs_wrap(VALUE klass, PJ *crs_to_crs,
+                                  RGeo_Proj4Data *from_data,
+                                  RGeo_Proj4Data *to_data) {
+  VALUE result;
+  RGeo_CRSToCRSData *data;
+  RGeo_PJLease lease;
 
-  // necessary to use proj_normalize_for_visualization so that we
-  // do not have to worry about the order of coordinates in every
-  // coord system
-  gis_pj = proj_normalize_for_visualization(local_proj_context, crs_to_crs);
-  if (gis_pj) {
-    proj_destroy(crs_to_crs);
-    crs_to_crs = gis_pj;
-  }
+  result = Qnil;
   data = ALLOC(RGeo_CRSToCRSData);
   if (data) {
-    data->crs_to_crs = crs_to_crs;
+    rgeo_crs_to_crs_data_init(data, crs_to_crs);
+    data->invertible = proj_pj_info(crs_to_crs).has_inverse ? 1 : 0;
+    data->from_radians = rgeo_proj4_uses_radians(from_data);
+    data->to_radians = rgeo_proj4_uses_radians(to_data);
     result = TypedData_Wrap_Struct(klass, &rgeo_crs_to_crs_data_type, data);
+
+    // The pipeline is checked through a lease, as transformations run it,
+    // so that it is never left bound to a context back in the pool.
+    rgeo_crs_to_crs_lease(data, &lease);
+    rgeo_crs_to_crs_bind(&lease);
+    rgeo_kernel_detect(&data->kernel, lease.ctx, from_data->pj, to_data->pj,
+                       lease.pj);
+    rgeo_crs_to_crs_unbind(&lease);
+    rgeo_crs_to_crs_unlease(&lease);
+    // Scaling between radians and degrees still has to happen.
+    if (data->kernel.type == RGEO_KERNEL_IDENTITY &&
+        data->from_radians != data->to_radians) {
+      data->kernel.type = RGEO_KERNEL_NONE;
+    }
   }
   return result;
 }
 
-static VALUE method_crs_to_crs_transform(VALUE self, VALUE x, VALUE y,
+// How an operation is picked among those PROJ finds between two CRSs.
+typedef enum {
+  // Keep every candidate, PROJ picks the most accurate one usable for each
+  // transformed coordinate, possibly reading grid files.
+  RGEO_POLICY_BEST,
+  // Use the most accurate candidate that needs no grid file.
+  RGEO_POLICY_NO_GRIDS,
+  // Use a ballpark transformation, which ignores datum differences, when
+  // there is one, and the most accurate candidate needing no grid file
+  // otherwise.
+  RGEO_POLICY_FASTEST
+} RGeo_Policy;
+
+static RGeo_Policy rgeo_policy_get(VALUE policy) {
+  ID id;
+
+  Check_Type(policy, T_SYMBOL);
+  id = SYM2ID(policy);
+  if (id == rb_intern("best")) {
+    return RGEO_POLICY_BEST;
+  }
+  if (id == rb_intern("no_grids")) {
+    return RGEO_POLICY_NO_GRIDS;
+  }
+  if (id == rb_intern("fastest")) {
+    return RGEO_POLICY_FASTEST;
+  }
+  rb_raise(rb_eArgError,
+           "policy must be :best, :no_grids or :fastest, got %" PRIsVALUE,
+           policy);
+}
+
+// Picks a single operation from from_pj to to_pj according to policy, among
+// the candidates found by PROJ, which come most accurate first. bbox is NULL
+// or the area of interest, and options the NULL-terminated options given
+// to proj_create_crs_to_crs_from_pj, of which ACCURACY and ALLOW_BALLPARK
+// are honoured. Returns NULL if no candidate fits.
+static PJ *rgeo_create_operation(PJ_CONTEXT *ctx, PJ *from_pj, PJ *to_pj,
+                                 const double *bbox, const char **options,
+                                 RGeo_Policy policy) {
+  PJ_OPERATION_FACTORY_CONTEXT *factory;
+  PJ_OBJ_LIST *candidates;
+  PJ *op;
+  PJ *result;
+  PJ *fallback;
+  int allow_ballpark;
+  int ballpark;
+  int count;
+  int i;
+
+  factory = proj_create_operation_factory_context(ctx, NULL);
+  if (!factory) {
+    return NULL;
+  }
+  allow_ballpark = 1;
+  for (i = 0; options && options[i]; i++) {
+    if (strncmp(options[i], "ACCURACY=", 9) == 0) {
+      proj_operation_factory_context_set_desired_accuracy(
+          ctx, factory, strtod(options[i] + 9, NULL));
+    } else if (strcmp(options[i], "ALLOW_BALLPARK=NO") == 0) {
+      allow_ballpark = 0;
+    }
+  }
+  if (bbox) {
+    proj_operation_factory_context_set_area_of_interest(ctx, factory, bbox[0],
+                                                        bbox[1], bbox[2],
+                                                        bbox[3]);
+  }
+  candidates = proj_create_operations(ctx, from_pj, to_pj, factory);
+  proj_operation_factory_context_destroy(factory);
+
+  result = NULL;
+  fallback = NULL;
+  count = candidates ? proj_list_get_count(candidates) : 0;
+  for (i = 0; i < count && !result; i++) {
+    op = proj_list_get(ctx, candidates, i);
+    if (!op) {
+      continue;
+    }
+    ballpark = proj_coordoperation_has_ballpark_transformation(ctx, op);
+    if (proj_coordoperation_get_grid_used_count(ctx, op) > 0 ||
+        !proj_coordoperation_is_instantiable(ctx, op) ||
+        (ballpark && !allow_ballpark)) {
+      proj_destroy(op);
+    } else if (ballpark == (policy == RGEO_POLICY_FASTEST)) {
+      result = op;
+    } else if (!fallback) {
+      fallback = op;
+    } else {
+      proj_destroy(op);
+    }
+  }
+  if (candidates) {
+    proj_list_destroy(candidates);
+  }
+  if (!result) {
+    result = fallback;
+  } else if (fallback) {
+    proj_destroy(fallback);
+  }
+  return result;
+}
+
+// Creates a pipeline from one CRS to another. area is nil or an Array of
+// four degrees (west, south, east, north) restricting the candidate
+// operations to those valid over that area of interest, and options is nil
+// or an Array of "KEY=VALUE" strings passed to
+// proj_create_crs_to_crs_from_pj. policy picks among the candidates, see
+// RGeo_Policy.
+static VALUE cmethod_crs_to_crs_create(VALUE klass, VALUE from, VALUE to,
+                                       VALUE area, VALUE options,
+                                       VALUE policy) {
+  RGeo_Proj4Data *from_data;
+  RGeo_Proj4Data *to_data;
+  PJ *from_pj;
+  PJ *to_pj;
+  PJ *gis_pj;
+  PJ *crs_to_crs;
+  PJ_CONTEXT *ctx;
+  PJ_AREA *pj_area;
+  const char **pj_options;
+  VALUE option;
+  double bbox[4];
+  size_t started;
+  long i;
+  long options_count;
+  RGeo_Policy pj_policy;
+
+  pj_policy = rgeo_policy_get(policy);
+  from_data = rgeo_proj4_get(from);
+  to_data = rgeo_proj4_get(to);
+  from_pj = from_data->pj;
+  to_pj = to_data->pj;
+
+  if (!NIL_P(area)) {
+    Check_Type(area, T_ARRAY);
+    if (RARRAY_LEN(area) != 4) {
+      rb_raise(rb_eArgError,
+               "area must be [west, south, east, north], got %ld values",
+               RARRAY_LEN(area));
+    }
+    for (i = 0; i < 4; i++) {
+      bbox[i] = rb_num2dbl(RARRAY_AREF(area, i));
+    }
+  }
+
+  pj_options = NULL;
+  if (!NIL_P(options)) {
+    Check_Type(options, T_ARRAY);
+    options_count = RARRAY_LEN(options);
+    pj_options = ALLOCA_N(const char *, options_count + 1);
+    for (i = 0; i < options_count; i++) {
+      option = RARRAY_AREF(options, i);
+      Check_Type(option, T_STRING);
+      pj_options[i] = StringValueCStr(option);
+    }
+    pj_options[options_count] = NULL;
+  }
+
+  started = rgeo_stats_clock();
+  ctx = rgeo_proj_context_acquire();
+  if (pj_policy == RGEO_POLICY_BEST) {
+    pj_area = NULL;
+    if (!NIL_P(area)) {
+      pj_area = proj_area_create();
+      proj_area_set_bbox(pj_area, bbox[0], bbox[1], bbox[2], bbox[3]);
+    }
+    crs_to_crs = proj_create_crs_to_crs_from_pj(ctx, from_pj, to_pj, pj_area,
+                                                pj_options);
+    if (pj_area) {
+      proj_area_destroy(pj_area);
+    }
+  } else {
+    crs_to_crs = rgeo_create_operation(ctx, from_pj, to_pj,
+                                       NIL_P(area) ? NULL : bbox, pj_options,
+                                       pj_policy);
+  }
+  RB_GC_GUARD(options);
+
+  // check for invalid transformation
+  if (crs_to_crs == 0) {
+    rgeo_proj_context_release(ctx);
+    rgeo_stats_add(RGEO_STAT_PROJ_ERRORS, 1);
+    rb_raise(rb_eRGeoInvalidProjectionError,
+             "CRSToCRS could not be created from input projections");
+  }
+
+  // necessary to use proj_normalize_for_visualization so that we
+  // do not have to worry about the order of coordinates in every
+  // coord system
+  gis_pj = proj_normalize_for_visualization(ctx, crs_to_crs);
+  if (gis_pj) {
+    proj_destroy(crs_to_crs);
+    crs_to_crs = gis_pj;
+  }
+  rgeo_proj_context_release(ctx);
+  rgeo_stats_add(RGEO_STAT_PIPELINES_CREATED, 1);
+  rgeo_stats_add(RGEO_STAT_PIPELINE_CREATE_TIME, rgeo_stats_clock() - started);
+  return rgeo_crs_to_crs_wrap(klass, crs_to_crs, from_data, to_data);
+}
+
+// Creates a CRSToCRS from the definition of a pipeline resolved earlier
+// between from and to, as returned by _definition, without searching for an
+// operation.
+static VALUE cmethod_crs_to_crs_create_from_definition(VALUE klass,
+                                                       VALUE definition,
+                                                       VALUE from, VALUE to) {
+  RGeo_Proj4Data *from_data;
+  RGeo_Proj4Data *to_data;
+  PJ *crs_to_crs;
+  PJ_CONTEXT *ctx;
+  size_t started;
+
+  from_data = rgeo_proj4_get(from);
+  to_data = rgeo_proj4_get(to);
+  Check_Type(definition, T_STRING);
+  started = rgeo_stats_clock();
+  ctx = rgeo_proj_context_acquire();
+  crs_to_crs = proj_create(ctx, StringValueCStr(definition));
+  rgeo_proj_context_release(ctx);
+  RB_GC_GUARD(definition);
+
+  if (crs_to_crs && proj_is_crs(crs_to_crs)) {
+    proj_destroy(crs_to_crs);
+    crs_to_crs = NULL;
+  }
+  if (!crs_to_crs) {
+    rgeo_stats_add(RGEO_STAT_PROJ_ERRORS, 1);
+    rb_raise(rb_eRGeoInvalidProjectionError,
+             "CRSToCRS could not be created from its definition");
+  }
+  rgeo_stats_add(RGEO_STAT_PIPELINES_CREATED, 1);
+  rgeo_stats_add(RGEO_STAT_PIPELINE_CREATE_TIME, rgeo_stats_clock() - started);
+  return rgeo_crs_to_crs_wrap(klass, crs_to_crs, from_data, to_data);
+}
+
+// Returns the PROJJSON definition of the pipeline, or nil when it cannot be
+// exported, as happens when PROJ kept several candidate operations.
+static VALUE method_crs_to_crs_definition(VALUE self) {
+  VALUE result;
+  RGeo_CRSToCRSData *crs_to_crs_data;
+
+  result = Qnil;
+  TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
+                       crs_to_crs_data);
+  if (crs_to_crs_data->crs_to_crs && crs_to_crs_data->direction == PJ_FWD) {
+    result = rgeo_pj_export_str(crs_to_crs_data->crs_to_crs,
+                                RGEO_EXPORT_PROJJSON);
+  }
+  if (!NIL_P(result)) {
+    rb_enc_associate(result, rb_utf8_encoding());
+  }
+  return result;
+}
+
+// Returns a CRSToCRS running the pipeline of self in the other direction,
+// or nil if the pipeline cannot be inverted.
+static VALUE method_crs_to_crs_inverse(VALUE self) {
+  VALUE result;
+  RGeo_CRSToCRSData *self_data;
+  RGeo_CRSToCRSData *data;
+
+  result = Qnil;
+  TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
+                       self_data);
+  if (self_data->crs_to_crs && self_data->invertible) {
+    data = ALLOC(RGeo_CRSToCRSData);
+    if (data) {
+      rgeo_crs_to_crs_data_init(data, self_data->crs_to_crs);
+      data->direction = self_data->direction == PJ_FWD ? PJ_INV : PJ_FWD;
+      data->invertible = 1;
+      data->from_radians = self_data->to_radians;
+      data->to_radians = self_data->from_radians;
+      data->base = NIL_P(self_data->base) ? self : self_data->base;
+      data->owner = self_data->owner;
+      data->kernel = self_data->kernel;
+      result = TypedData_Wrap_Struct(CLASS_OF(self),
+                                     &rgeo_crs_to_crs_data_type, data);
+    }
+  }
+  return result;
+}
+
+typedef struct {
+  RGeo_CRSToCRSData *data;
+  RGeo_PJLease lease;
+  double bounds[4];
+  double max_error;
+  RGeo_ApproxGrid *grid;
+} RGeo_ApproximateArgs;
+
+static void rgeo_approximate_sample(void *arg, double *x, double *y,
+                                    size_t count) {
+  RGeo_ApproximateArgs *args = (RGeo_ApproximateArgs *)arg;
+  rgeo_crs_to_crs_bind(&args->lease);
+  proj_trans_generic(args->lease.pj, args->data->direction, x,
+                     sizeof(double), count, y, sizeof(double), count, NULL, 0,
+                     0, NULL, 0, 0);
+  rgeo_crs_to_crs_unbind(&args->lease);
+}
+
+static VALUE rgeo_approximate_body(VALUE ptr) {
+  RGeo_ApproximateArgs *args = (RGeo_ApproximateArgs *)ptr;
+  rgeo_crs_to_crs_lease(args->data, &args->lease);
+  args->grid = rgeo_approx_build(args->bounds, args->max_error,
+                                 rgeo_approximate_sample, args);
+  return Qnil;
+}
+
+static VALUE rgeo_approximate_ensure(VALUE ptr) {
+  RGeo_ApproximateArgs *args = (RGeo_ApproximateArgs *)ptr;
+  rgeo_crs_to_crs_unlease(&args->lease);
+  return Qnil;
+}
+
+// Returns a CRSToCRS running the pipeline of self, interpolated over bounds
+// [xmin, ymin, xmax, ymax] within max_error, in the units of the source and
+// target coordinates. Returns nil if self has no pipeline.
+static VALUE method_crs_to_crs_approximate(VALUE self, VALUE bounds,
+                                           VALUE max_error) {
+  VALUE result;
+  RGeo_CRSToCRSData *self_data;
+  RGeo_CRSToCRSData *data;
+  RGeo_ApproximateArgs args;
+  int i;
+
+  TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
+                       self_data);
+  if (!self_data->crs_to_crs) {
+    return Qnil;
+  }
+  Check_Type(bounds, T_ARRAY);
+  if (RARRAY_LEN(bounds) != 4) {
+    rb_raise(rb_eArgError, "bounds must be [xmin, ymin, xmax, ymax]");
+  }
+  for (i = 0; i < 4; i++) {
+    args.bounds[i] = NUM2DBL(rb_ary_entry(bounds, i));
+  }
+  if (!(args.bounds[0] < args.bounds[2] && args.bounds[1] < args.bounds[3])) {
+    rb_raise(rb_eArgError, "bounds must not be empty");
+  }
+  args.max_error = NUM2DBL(max_error);
+  if (!(args.max_error > 0.0)) {
+    rb_raise(rb_eArgError, "maximum error must be positive");
+  }
+  if (self_data->from_radians) {
+    for (i = 0; i < 4; i++) {
+      args.bounds[i] *= RGEO_DEGREES_PER_RADIAN;
+    }
+  }
+  if (self_data->to_radians) {
+    args.max_error *= RGEO_DEGREES_PER_RADIAN;
+  }
+
+  // The result is wrapped first, so that it owns the grid once built.
+  data = ALLOC(RGeo_CRSToCRSData);
+  rgeo_crs_to_crs_data_init(data, self_data->crs_to_crs);
+  data->direction = self_data->direction;
+  data->invertible = self_data->invertible;
+  data->from_radians = self_data->from_radians;
+  data->to_radians = self_data->to_radians;
+  data->base = NIL_P(self_data->base) ? self : self_data->base;
+  data->owner = self_data->owner;
+  data->kernel = self_data->kernel;
+  result =
+      TypedData_Wrap_Struct(CLASS_OF(self), &rgeo_crs_to_crs_data_type, data);
+
+  args.data = self_data;
+  args.lease.ctx = NULL;
+  args.grid = NULL;
+  rb_ensure(rgeo_approximate_body, (VALUE)&args, rgeo_approximate_ensure,
+            (VALUE)&args);
+  data->approx = args.grid;
+  return result;
+}
+
+// Leases a pooled context and the copy of the pipeline bound to it, cloning
+// the pipeline the first time a context is used with it. When no clone can
+// be made, the shared pipeline is returned and the transformation has to run
+// with the GVL held, bound to the context with rgeo_crs_to_crs_bind.
+static void rgeo_crs_to_crs_lease(RGeo_CRSToCRSData *data,
+                                  RGeo_PJLease *lease) {
+  RGeo_PJClone *clone;
+  PJ *pj;
+
+  data = data->owner;
+  lease->owner = data;
+  lease->ctx = rgeo_proj_context_acquire();
+  lease->pj = NULL;
+
+  rb_nativethread_lock_lock(&data->clones_lock);
+  for (clone = data->clones; clone; clone = clone->next) {
+    if (clone->ctx == lease->ctx) {
+      lease->pj = clone->pj;
+      break;
+    }
+  }
+  rb_nativethread_lock_unlock(&data->clones_lock);
+
+#ifdef HAVE_PROJ_CLONE
+  if (!lease->pj) {
+    pj = proj_clone(lease->ctx, data->crs_to_crs);
+    if (pj) {
+      clone = ALLOC(RGeo_PJClone);
+      clone->ctx = lease->ctx;
+      clone->pj = pj;
+
+      rb_nativethread_lock_lock(&data->clones_lock);
+      clone->next = data->clones;
+      data->clones = clone;
+      data->clone_count++;
+      rb_nativethread_lock_unlock(&data->clones_lock);
+
+      lease->pj = pj;
+    }
+  }
+#else
+  (void)pj;
+#endif
+
+  lease->shared = lease->pj == NULL;
+  if (lease->shared) {
+    lease->pj = data->crs_to_crs;
+  }
+}
+
+// Binds the pipeline of a shared lease to the context of the lease until
+// rgeo_crs_to_crs_unbind, locking out the other Ractors running it
+// meanwhile. Does nothing for a lease holding a clone.
+static void rgeo_crs_to_crs_bind(RGeo_PJLease *lease) {
+  if (lease->shared) {
+    rb_nativethread_lock_lock(&lease->owner->shared_lock);
+    proj_assign_context(lease->pj, lease->ctx);
+  }
+}
+
+static void rgeo_crs_to_crs_unbind(RGeo_PJLease *lease) {
+  if (lease->shared) {
+    rb_nativethread_lock_unlock(&lease->owner->shared_lock);
+  }
+}
+
+static void rgeo_crs_to_crs_unlease(RGeo_PJLease *lease) {
+  if (lease->ctx) {
+    rgeo_proj_context_release(lease->ctx);
+    lease->ctx = NULL;
+  }
+}
+
+// Runs func outside of the GVL when the lease holds a private pipeline, and
+// with the shared pipeline bound to the context of the lease otherwise.
+static void rgeo_crs_to_crs_run(RGeo_PJLease *lease, void *(*func)(void *),
+                                void *args, rb_unblock_function_t *ubf) {
+  if (lease->shared) {
+    rgeo_crs_to_crs_bind(lease);
+    func(args);
+    rgeo_crs_to_crs_unbind(lease);
+  } else {
+    rb_thread_call_without_gvl(func, args, ubf, args);
+  }
+}
+
+typedef struct {
+  RGeo_CRSToCRSData *data;
+  RGeo_PJLease lease;
+  PJ_COORD coord;
+} RGeo_TransformPointArgs;
+
+static void *rgeo_transform_point(void *ptr) {
+  RGeo_TransformPointArgs *args = (RGeo_TransformPointArgs *)ptr;
+  args->coord = proj_trans(args->lease.pj, args->data->direction, args->coord);
+  rgeo_stats_add(RGEO_STAT_POINTS_TRANSFORMED, 1);
+  if (args->coord.xyz.x == HUGE_VAL) {
+    rgeo_stats_add(RGEO_STAT_PROJ_ERRORS, 1);
+  }
+  return NULL;
+}
+
+static VALUE rgeo_transform_point_body(VALUE ptr) {
+  RGeo_TransformPointArgs *args = (RGeo_TransformPointArgs *)ptr;
+  rgeo_crs_to_crs_lease(args->data, &args->lease);
+  rgeo_crs_to_crs_run(&args->lease, rgeo_transform_point, args, NULL);
+  return Qnil;
+}
+
+static VALUE rgeo_transform_point_ensure(VALUE ptr) {
+  RGeo_TransformPointArgs *args = (RGeo_TransformPointArgs *)ptr;
+  rgeo_crs_to_crs_unlease(&args->lease);
+  return Qnil;
+}
+
+static VALUE method_crs_to_crs_transform(VALUE self, VALUE x, VALUE y,
                                          VALUE z) {
   VALUE result;
   RGeo_CRSToCRSData *crs_to_crs_data;
-  PJ *crs_to_crs_pj;
-  double xval, yval, zval;
-  PJ_COORD input;
-  PJ_COORD output;
+  double xval, yval, zval;
+  RGeo_TransformPointArgs args;
+  RGeo_KernelFunc kernel;
+
+  result = Qnil;
+  TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
+                       crs_to_crs_data);
+  if (crs_to_crs_data->crs_to_crs) {
+    xval = rb_num2dbl(x);
+    yval = rb_num2dbl(y);
+    zval = NIL_P(z) ? 0.0 : rb_num2dbl(z);
+    if (crs_to_crs_data->from_radians) {
+      xval *= RGEO_DEGREES_PER_RADIAN;
+      yval *= RGEO_DEGREES_PER_RADIAN;
+    }
+
+    args.data = crs_to_crs_data;
+    args.lease.ctx = NULL;
+    args.coord = proj_coord(xval, yval, zval, HUGE_VAL);
+    kernel = rgeo_kernel_func(&crs_to_crs_data->kernel,
+                              crs_to_crs_data->direction);
+    if (kernel ? kernel(&crs_to_crs_data->kernel, &args.coord.xyz.x,
+                        &args.coord.xyz.y)
+               : crs_to_crs_data->approx && NIL_P(z) &&
+                     rgeo_approx_eval(crs_to_crs_data->approx,
+                                      &args.coord.xyz.x, &args.coord.xyz.y)) {
+      rgeo_stats_add(RGEO_STAT_POINTS_TRANSFORMED, 1);
+    } else {
+      rb_ensure(rgeo_transform_point_body, (VALUE)&args,
+                rgeo_transform_point_ensure, (VALUE)&args);
+    }
+    if (crs_to_crs_data->to_radians) {
+      args.coord.xyz.x *= 1.0 / RGEO_DEGREES_PER_RADIAN;
+      args.coord.xyz.y *= 1.0 / RGEO_DEGREES_PER_RADIAN;
+    }
+
+    result = rb_ary_new2(NIL_P(z) ? 2 : 3);
+    rb_ary_push(result, DBL2NUM(args.coord.xyz.x));
+    rb_ary_push(result, DBL2NUM(args.coord.xyz.y));
+    if (!NIL_P(z)) {
+      rb_ary_push(result, DBL2NUM(args.coord.xyz.z));
+    }
+  }
+  return result;
+}
+
+// Fetches the bytes behind a binary String or an IO::Buffer holding packed
+// doubles. When writable is set, the buffer is checked for mutability (and
+// unshared for strings) before handing out its pointer.
+static void rgeo_buffer_get_bytes(VALUE buffer, int writable, void **base,
+                                  size_t *size) {
+  if (RB_TYPE_P(buffer, T_STRING)) {
+    if (writable) {
+      rb_str_modify(buffer);
+    }
+    *base = RSTRING_PTR(buffer);
+    *size = RSTRING_LEN(buffer);
+  }
+#ifdef HAVE_RB_IO_BUFFER_GET_BYTES_FOR_WRITING
+  else if (rb_obj_is_kind_of(buffer, rb_cIOBuffer)) {
+    if (writable) {
+      rb_io_buffer_get_bytes_for_writing(buffer, base, size);
+    } else {
+      rb_io_buffer_get_bytes_for_reading(buffer, (const void **)base, size);
+    }
+  }
+#endif
+  else {
+    rb_raise(rb_eTypeError, "expected a String or IO::Buffer, got %" PRIsVALUE,
+             rb_obj_class(buffer));
+  }
+
+  if ((uintptr_t)*base % sizeof(double) != 0) {
+    rb_raise(rb_eArgError, "buffer is not aligned on a double boundary");
+  }
+}
+
+// Prevents the buffer from being resized or freed while the GVL is released.
+static void rgeo_buffer_lock(VALUE buffer) {
+  if (RB_TYPE_P(buffer, T_STRING)) {
+    rb_str_locktmp(buffer);
+  }
+#ifdef HAVE_RB_IO_BUFFER_GET_BYTES_FOR_WRITING
+  else {
+    rb_io_buffer_lock(buffer);
+  }
+#endif
+}
+
+static void rgeo_buffer_unlock(VALUE buffer) {
+  if (RB_TYPE_P(buffer, T_STRING)) {
+    rb_str_unlocktmp(buffer);
+  }
+#ifdef HAVE_RB_IO_BUFFER_GET_BYTES_FOR_WRITING
+  else {
+    rb_io_buffer_unlock(buffer);
+  }
+#endif
+}
+
+static void rgeo_scale_xy(char *x, char *y, size_t stride, size_t count,
+                          double factor) {
+  size_t i;
+  for (i = 0; i < count; i++) {
+    *(double *)(x + i * stride) *= factor;
+    *(double *)(y + i * stride) *= factor;
+  }
+}
+
+// Number of coordinates transformed between two checks for interrupts when
+// running outside of the GVL.
+#define RGEO_TRANSFORM_CHUNK_SIZE 4096
+
+// Number of coordinate columns: x, y and z.
+#define RGEO_TRANSFORM_COLUMNS 3
+
+// What to do with coordinates PROJ fails to transform.
+typedef enum {
+  // Leave them as returned by PROJ, set to HUGE_VAL.
+  RGEO_ON_ERROR_KEEP,
+  // Set them to NaN.
+  RGEO_ON_ERROR_NAN,
+  // Stop at the chunk holding the first one and raise.
+  RGEO_ON_ERROR_RAISE
+} RGeo_OnError;
+
+typedef struct {
+  RGeo_CRSToCRSData *data;
+  RGeo_PJLease lease;
+  // Ruby buffers holding the columns, locked while the GVL is released. Qnil
+  // for columns in memory not owned by Ruby.
+  VALUE buffers[RGEO_TRANSFORM_COLUMNS];
+  char locked;
+  // Columns of coordinates, each value stride bytes after the previous one.
+  // Interleaved coordinates are columns starting one double apart. z is NULL
+  // for 2D coordinates.
+  char *x;
+  char *y;
+  char *z;
+  size_t stride;
+  size_t count;
+  size_t offset;
+  volatile int interrupted;
+  RGeo_OnError on_error;
+  // Bitmap with a bit set for each transformed coordinate, least significant
+  // bit first, or NULL. first is the index of x in it, a multiple of 8 so
+  // that parallel parts never share a byte.
+  unsigned char *validity;
+  size_t first;
+  // Failures found so far, and for RGEO_ON_ERROR_RAISE whether the
+  // transformation stopped, at which index and why.
+  size_t failures;
+  char stopped;
+  size_t failed_index;
+  char error[128];
+} RGeo_TransformBufferArgs;
+
+// Describes the first failure of args from the error PROJ reported for it:
+// on the leased pipeline, which ran the coordinate, or else on the leased
+// context, which PROJ also sets when one of the operations kept by the
+// pipeline fails.
+static void rgeo_transform_error_message(RGeo_TransformBufferArgs *args) {
+  const char *str;
+  int code;
+
+  code = 0;
+  if (args->lease.pj) {
+    code = proj_errno(args->lease.pj);
+    if (!code) {
+      code = proj_context_errno(args->lease.ctx);
+    }
+  }
+#if PROJ_VERSION_MAJOR >= 8
+  str = code ? proj_context_errno_string(args->lease.ctx, code) : NULL;
+#else
+  str = code ? proj_errno_string(code) : NULL;
+#endif
+  snprintf(args->error, sizeof(args->error), "%s",
+           str ? str : "coordinate outside of the domain of the operation");
+}
+
+// Checks the results of the n coordinates transformed from x, counting and
+// handling failures and filling the validity bitmap.
+static void rgeo_transform_check(RGeo_TransformBufferArgs *args, char *x,
+                                 char *y, char *z, size_t n) {
+  size_t stride;
+  size_t errors;
+  size_t index;
+  size_t i;
+
+  stride = args->stride;
+  errors = 0;
+  for (i = 0; i < n; i++) {
+    index = args->first + args->offset + i;
+    if (*(double *)(x + i * stride) != HUGE_VAL) {
+      if (args->validity) {
+        args->validity[index >> 3] |= (unsigned char)(1 << (index & 7));
+      }
+      continue;
+    }
+    if (!errors && !args->failures) {
+      args->failed_index = index;
+      rgeo_transform_error_message(args);
+    }
+    errors++;
+    if (args->on_error == RGEO_ON_ERROR_NAN) {
+      *(double *)(x + i * stride) = NAN;
+      *(double *)(y + i * stride) = NAN;
+      if (z) {
+        *(double *)(z + i * stride) = NAN;
+      }
+    }
+  }
+  if (errors) {
+    rgeo_stats_add(RGEO_STAT_PROJ_ERRORS, errors);
+    args->failures += errors;
+    if (args->on_error == RGEO_ON_ERROR_RAISE) {
+      args->stopped = 1;
+    }
+  }
+}
+
+// Runs the pipeline over coordinates start to end of a chunk.
+static void rgeo_transform_run(RGeo_TransformBufferArgs *args, char *x,
+                               char *y, char *z, size_t start, size_t end) {
+  size_t stride;
+
+  if (end <= start) {
+    return;
+  }
+  stride = args->stride;
+  proj_trans_generic(args->lease.pj, args->data->direction,
+                     (double *)(x + start * stride), stride, end - start,
+                     (double *)(y + start * stride), stride, end - start,
+                     z ? (double *)(z + start * stride) : NULL, stride,
+                     z ? end - start : 0, NULL, 0, 0);
+}
+
+// Runs the pipeline over the n coordinates of a chunk. Coordinates handled
+// by the kernel of the pipeline, or 2D ones covered by its approximate grid,
+// are computed that way instead, runs of the others going through PROJ.
+static void rgeo_transform_chunk(RGeo_TransformBufferArgs *args, char *x,
+                                 char *y, char *z, size_t n) {
+  const RGeo_Kernel *kernel;
+  RGeo_KernelFunc kernel_func;
+  const RGeo_ApproxGrid *approx;
+  size_t stride;
+  size_t start;
+  size_t i;
+
+  kernel = &args->data->kernel;
+  kernel_func = rgeo_kernel_func(kernel, args->data->direction);
+  approx = args->data->approx;
+  stride = args->stride;
+  start = 0;
+  if (kernel_func) {
+    // The kernels replace 2D conversions, z goes through unchanged.
+    for (i = 0; i < n; i++) {
+      if (kernel_func(kernel, (double *)(x + i * stride),
+                      (double *)(y + i * stride))) {
+        rgeo_transform_run(args, x, y, z, start, i);
+        start = i + 1;
+      }
+    }
+  } else if (approx && !z) {
+    for (i = 0; i < n; i++) {
+      if (rgeo_approx_eval(approx, (double *)(x + i * stride),
+                           (double *)(y + i * stride))) {
+        rgeo_transform_run(args, x, y, z, start, i);
+        start = i + 1;
+      }
+    }
+  }
+  rgeo_transform_run(args, x, y, z, start, n);
+}
+
+static void *rgeo_transform_buffer(void *ptr) {
+  RGeo_TransformBufferArgs *args = (RGeo_TransformBufferArgs *)ptr;
+  size_t stride;
+  size_t n;
+  char *x;
+  char *y;
+  char *z;
+
+  stride = args->stride;
+  while (args->offset < args->count && !args->stopped && !args->interrupted) {
+    n = args->count - args->offset;
+    if (n > RGEO_TRANSFORM_CHUNK_SIZE) {
+      n = RGEO_TRANSFORM_CHUNK_SIZE;
+    }
+    x = args->x + args->offset * stride;
+    y = args->y + args->offset * stride;
+    z = args->z ? args->z + args->offset * stride : NULL;
+
+    if (args->data->from_radians) {
+      rgeo_scale_xy(x, y, stride, n, RGEO_DEGREES_PER_RADIAN);
+    }
+    proj_errno_reset(args->lease.pj);
+    rgeo_transform_chunk(args, x, y, z, n);
+    if (args->data->to_radians) {
+      rgeo_scale_xy(x, y, stride, n, 1.0 / RGEO_DEGREES_PER_RADIAN);
+    }
+    rgeo_stats_add(RGEO_STAT_POINTS_TRANSFORMED, n);
+    rgeo_transform_check(args, x, y, z, n);
+    args->offset += n;
+  }
+  return NULL;
+}
+
+static void rgeo_transform_buffer_interrupt(void *ptr) {
+  RGeo_TransformBufferArgs *args = (RGeo_TransformBufferArgs *)ptr;
+  args->interrupted = 1;
+}
+
+// Transforms a slice of the coordinates of a parallel transformation, on a
+// worker thread.
+static void rgeo_transform_buffer_part(void *ptr, size_t index) {
+  RGeo_TransformBufferArgs *parts = (RGeo_TransformBufferArgs *)ptr;
+  rgeo_transform_buffer(&parts[index]);
+}
+
+// Locks the distinct buffers holding the columns of args.
+static void rgeo_transform_buffers_lock(RGeo_TransformBufferArgs *args) {
+  int i;
+  int j;
+
+  for (i = 0; i < RGEO_TRANSFORM_COLUMNS; i++) {
+    for (j = 0; j < i && args->buffers[j] != args->buffers[i]; j++) {
+    }
+    if (j == i && !NIL_P(args->buffers[i])) {
+      rgeo_buffer_lock(args->buffers[i]);
+    }
+  }
+  args->locked = 1;
+}
+
+static void rgeo_transform_buffers_unlock(RGeo_TransformBufferArgs *args) {
+  int i;
+  int j;
+
+  if (!args->locked) {
+    return;
+  }
+  for (i = 0; i < RGEO_TRANSFORM_COLUMNS; i++) {
+    for (j = 0; j < i && args->buffers[j] != args->buffers[i]; j++) {
+    }
+    if (j == i && !NIL_P(args->buffers[i])) {
+      rgeo_buffer_unlock(args->buffers[i]);
+    }
+  }
+  args->locked = 0;
+}
+
+static VALUE rgeo_transform_buffer_body(VALUE ptr) {
+  RGeo_TransformBufferArgs *args = (RGeo_TransformBufferArgs *)ptr;
+
+  rgeo_crs_to_crs_lease(args->data, &args->lease);
+  if (!args->lease.shared) {
+    rgeo_transform_buffers_lock(args);
+  }
+  // Interrupts that do not raise (such as signal traps) only pause the
+  // transformation, it resumes where it stopped.
+  while (args->offset < args->count && !args->stopped) {
+    args->interrupted = 0;
+    rgeo_crs_to_crs_run(&args->lease, rgeo_transform_buffer, args,
+                        rgeo_transform_buffer_interrupt);
+  }
+  return Qnil;
+}
+
+static VALUE rgeo_transform_buffer_ensure(VALUE ptr) {
+  RGeo_TransformBufferArgs *args = (RGeo_TransformBufferArgs *)ptr;
+
+  rgeo_transform_buffers_unlock(args);
+  rgeo_crs_to_crs_unlease(&args->lease);
+  return Qnil;
+}
+
+// Smallest number of coordinates worth handing to a worker thread.
+#define RGEO_TRANSFORM_PART_SIZE 16384
+
+// Coordinates split in parts, each one transformed by its own pipeline clone
+// on a worker thread. The buffers are locked through the first part, and
+// the outcome of the parts is gathered into batch.
+typedef struct {
+  RGeo_TransformBufferArgs *batch;
+  RGeo_TransformBufferArgs *parts;
+  size_t part_count;
+} RGeo_TransformPartsArgs;
+
+static void *rgeo_transform_parts(void *ptr) {
+  RGeo_TransformPartsArgs *args = (RGeo_TransformPartsArgs *)ptr;
+  rgeo_workers_run(rgeo_transform_buffer_part, args->parts, args->part_count);
+  return NULL;
+}
+
+static void rgeo_transform_parts_interrupt(void *ptr) {
+  RGeo_TransformPartsArgs *args = (RGeo_TransformPartsArgs *)ptr;
+  size_t i;
+
+  for (i = 0; i < args->part_count; i++) {
+    args->parts[i].interrupted = 1;
+  }
+}
+
+static int rgeo_transform_parts_done(RGeo_TransformPartsArgs *args) {
+  size_t i;
+
+  for (i = 0; i < args->part_count; i++) {
+    if (args->parts[i].offset < args->parts[i].count &&
+        !args->parts[i].stopped) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void rgeo_transform_parts_gather(RGeo_TransformPartsArgs *args) {
+  RGeo_TransformBufferArgs *batch;
+  RGeo_TransformBufferArgs *part;
+  size_t i;
+
+  batch = args->batch;
+  for (i = 0; i < args->part_count; i++) {
+    part = &args->parts[i];
+    if (part->failures && !batch->failures) {
+      batch->failed_index = part->failed_index;
+      memcpy(batch->error, part->error, sizeof(batch->error));
+    }
+    batch->failures += part->failures;
+    batch->stopped |= part->stopped;
+  }
+}
+
+static VALUE rgeo_transform_parts_body(VALUE ptr) {
+  RGeo_TransformPartsArgs *args = (RGeo_TransformPartsArgs *)ptr;
+  RGeo_TransformBufferArgs *part;
+  int parallel;
+  size_t i;
+
+  // Leases are taken with the GVL held, each part gets its own context and
+  // pipeline clone. Without clones, parts run one after the other.
+  parallel = rgeo_workers_prepare();
+  for (i = 0; i < args->part_count; i++) {
+    part = &args->parts[i];
+    rgeo_crs_to_crs_lease(part->data, &part->lease);
+    if (part->lease.shared) {
+      parallel = 0;
+    }
+  }
+  rgeo_transform_buffers_lock(&args->parts[0]);
+
+  while (!rgeo_transform_parts_done(args)) {
+    for (i = 0; i < args->part_count; i++) {
+      args->parts[i].interrupted = 0;
+    }
+    if (parallel) {
+      rb_thread_call_without_gvl(rgeo_transform_parts, args,
+                                 rgeo_transform_parts_interrupt, args);
+    } else {
+      for (i = 0; i < args->part_count; i++) {
+        part = &args->parts[i];
+        rgeo_crs_to_crs_run(&part->lease, rgeo_transform_buffer, part,
+                            rgeo_transform_buffer_interrupt);
+      }
+    }
+  }
+  rgeo_transform_parts_gather(args);
+  return Qnil;
+}
+
+static VALUE rgeo_transform_parts_ensure(VALUE ptr) {
+  RGeo_TransformPartsArgs *args = (RGeo_TransformPartsArgs *)ptr;
+  size_t i;
+
+  rgeo_transform_buffers_unlock(&args->parts[0]);
+  for (i = 0; i < args->part_count; i++) {
+    rgeo_crs_to_crs_unlease(&args->parts[i].lease);
+  }
+  FREE(args->parts);
+  return Qnil;
+}
+
+// Returns the number of parts the coordinates of args are split into, up to
+// one per worker thread when parallel is set, and sets part_size to the
+// number of coordinates in each one.
+static size_t rgeo_transform_part_count(RGeo_TransformBufferArgs *args,
+                                        int parallel, size_t *part_size) {
+  size_t part_count;
+
+  part_count = 1;
+  if (parallel) {
+    part_count = (args->count + RGEO_TRANSFORM_PART_SIZE - 1) /
+                 RGEO_TRANSFORM_PART_SIZE;
+    if (part_count > rgeo_workers_count()) {
+      part_count = rgeo_workers_count();
+    }
+  }
+  if (part_count <= 1) {
+    *part_size = args->count;
+    return 1;
+  }
+  // Parts start on a byte of the validity bitmap.
+  *part_size = (args->count + part_count - 1) / part_count;
+  *part_size = (*part_size + 7) & ~(size_t)7;
+  return (args->count + *part_size - 1) / *part_size;
+}
+
+// Returns part_count copies of args, each one covering part_size of its
+// coordinates.
+static RGeo_TransformBufferArgs *
+rgeo_transform_parts_split(RGeo_TransformBufferArgs *args, size_t part_count,
+                           size_t part_size) {
+  RGeo_TransformBufferArgs *parts;
+  RGeo_TransformBufferArgs *part;
+  size_t i;
+
+  parts = ALLOC_N(RGeo_TransformBufferArgs, part_count);
+  for (i = 0; i < part_count; i++) {
+    part = &parts[i];
+    *part = *args;
+    part->first = i * part_size;
+    part->x += i * part_size * args->stride;
+    part->y += i * part_size * args->stride;
+    if (part->z) {
+      part->z += i * part_size * args->stride;
+    }
+    part->count =
+        i + 1 < part_count ? part_size : args->count - i * part_size;
+  }
+  return parts;
+}
+
+static void rgeo_crs_to_crs_transform_parts(RGeo_TransformBufferArgs *args,
+                                            size_t part_count,
+                                            size_t part_size) {
+  RGeo_TransformPartsArgs parts_args;
+
+  parts_args.batch = args;
+  parts_args.parts = rgeo_transform_parts_split(args, part_count, part_size);
+  parts_args.part_count = part_count;
+  rb_ensure(rgeo_transform_parts_body, (VALUE)&parts_args,
+            rgeo_transform_parts_ensure, (VALUE)&parts_args);
+}
+
+// Returns the RGeo::Error::TransformError for the failure that stopped args,
+// item naming what its elements are.
+static VALUE rgeo_transform_error_new(RGeo_TransformBufferArgs *args,
+                                      const char *item) {
+  VALUE error;
+
+  error = rb_exc_new_str(
+      rb_eRGeoTransformError,
+      rb_sprintf("%s %" PRIuSIZE " could not be transformed: %s", item,
+                 args->failed_index, args->error));
+  rb_iv_set(error, "@index", SIZET2NUM(args->failed_index));
+  return error;
+}
+
+static void rgeo_raise_transform_error(RGeo_TransformBufferArgs *args,
+                                       const char *item) {
+  rb_exc_raise(rgeo_transform_error_new(args, item));
+}
+
+// Clears the progress and outcome of args before it is transformed.
+static void rgeo_transform_args_reset(RGeo_TransformBufferArgs *args) {
+  args->lease.ctx = NULL;
+  args->locked = 0;
+  args->offset = 0;
+  args->interrupted = 0;
+  args->first = 0;
+  args->failures = 0;
+  args->stopped = 0;
+  args->failed_index = 0;
+  args->error[0] = '\0';
+}
+
+// Transforms the columns described by args, whose data, buffers, columns,
+// stride, count, on_error and validity are set. When parallel is set, large
+// columns are split between the worker threads. Every coordinate is
+// transformed on its own, so results do not depend on the split. A failure
+// stopping the transformation is raised by rgeo_transform_finish.
+static void rgeo_crs_to_crs_transform_columns(RGeo_TransformBufferArgs *args,
+                                              int parallel) {
+  size_t part_count;
+  size_t part_size;
+
+  rgeo_transform_args_reset(args);
+  part_count = rgeo_transform_part_count(args, parallel, &part_size);
+
+  if (args->data->kernel.type == RGEO_KERNEL_IDENTITY) {
+    // Coordinates are already where the results go, they only need to be
+    // checked for the failures PROJ would report.
+    args->lease.pj = NULL;
+    rgeo_stats_add(RGEO_STAT_POINTS_TRANSFORMED, args->count);
+    rgeo_transform_check(args, args->x, args->y, args->z, args->count);
+  } else if (part_count == 1) {
+    rb_ensure(rgeo_transform_buffer_body, (VALUE)args,
+              rgeo_transform_buffer_ensure, (VALUE)args);
+  } else {
+    rgeo_crs_to_crs_transform_parts(args, part_count, part_size);
+  }
+}
+
+static RGeo_OnError rgeo_on_error_get(VALUE on_error) {
+  ID id;
+
+  Check_Type(on_error, T_SYMBOL);
+  id = SYM2ID(on_error);
+  if (id == rb_intern("keep")) {
+    return RGEO_ON_ERROR_KEEP;
+  }
+  if (id == rb_intern("nan")) {
+    return RGEO_ON_ERROR_NAN;
+  }
+  if (id == rb_intern("raise")) {
+    return RGEO_ON_ERROR_RAISE;
+  }
+  rb_raise(rb_eArgError,
+           "on_error must be :keep, :nan or :raise, got %" PRIsVALUE,
+           on_error);
+}
+
+// Sets the failure policy of args, and when a TransformStatus is given as
+// status allocates the validity bitmap filling it, returned as a binary
+// String.
+static VALUE rgeo_transform_status_prepare(RGeo_TransformBufferArgs *args,
+                                           VALUE on_error, VALUE status) {
+  VALUE validity;
+
+  args->on_error = rgeo_on_error_get(on_error);
+  args->validity = NULL;
+  validity = Qnil;
+  if (!NIL_P(status)) {
+    validity = rb_str_new(NULL, (args->count + 7) / 8);
+    memset(RSTRING_PTR(validity), 0, RSTRING_LEN(validity));
+    args->validity = (unsigned char *)RSTRING_PTR(validity);
+  }
+  return validity;
+}
+
+// Fills status, a TransformStatus or nil, in with the outcome of a batch.
+static void rgeo_transform_status_fill(RGeo_TransformBufferArgs *args,
+                                       VALUE status, VALUE validity) {
+  if (!NIL_P(status)) {
+    rb_funcall(status, rb_intern("update"), 3, SIZET2NUM(args->count),
+               SIZET2NUM(args->failures), validity);
+  }
+}
+
+// Fills status in, then raises RGeo::Error::TransformError when a failure
+// stopped the batch, item naming what its elements are. The status is filled
+// in before raising, so that it tells which elements were transformed.
+static void rgeo_transform_finish(RGeo_TransformBufferArgs *args,
+                                  VALUE status, VALUE validity,
+                                  const char *item) {
+  rgeo_transform_status_fill(args, status, validity);
+  if (args->stopped) {
+    rgeo_raise_transform_error(args, item);
+  }
+}
+
+// Transforms count coordinates packed as x, y and z in coords, held by
+// buffer, a String or IO::Buffer that is locked while the GVL is released.
+// z values are left alone unless has_z is set, so that 2D coordinates can be
+// interpolated by an approximate grid. See rgeo_transform_status_prepare for
+// on_error and status.
+static void rgeo_crs_to_crs_transform_coords(RGeo_CRSToCRSData *data,
+                                             VALUE buffer, double *coords,
+                                             size_t count, int has_z,
+                                             VALUE on_error, VALUE status) {
+  RGeo_TransformBufferArgs args;
+  VALUE validity;
+
+  args.data = data;
+  args.buffers[0] = buffer;
+  args.buffers[1] = buffer;
+  args.buffers[2] = buffer;
+  args.x = (char *)coords;
+  args.y = (char *)(coords + 1);
+  args.z = has_z ? (char *)(coords + 2) : NULL;
+  args.stride = 3 * sizeof(double);
+  args.count = count;
+  validity = rgeo_transform_status_prepare(&args, on_error, status);
+  rgeo_crs_to_crs_transform_columns(&args, 0);
+  rgeo_transform_finish(&args, status, validity, "coordinate");
+
+  RB_GC_GUARD(validity);
+}
+
+// Transforms a buffer of interleaved coordinates, in place or into dst,
+// filling status in when it is a TransformStatus.
+static VALUE method_crs_to_crs_transform_buffer(VALUE self, VALUE src,
+                                                VALUE dst, VALUE dimension,
+                                                VALUE parallel, VALUE on_error,
+                                                VALUE status) {
+  RGeo_CRSToCRSData *crs_to_crs_data;
+  RGeo_TransformBufferArgs args;
+  VALUE validity;
+  int dim;
+  size_t stride;
+  void *src_base;
+  void *dst_base;
+  size_t src_size;
+  size_t dst_size;
+
+  TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
+                       crs_to_crs_data);
+  if (!crs_to_crs_data->crs_to_crs) {
+    return Qnil;
+  }
+
+  Check_Type(dimension, T_FIXNUM);
+  dim = FIX2INT(dimension);
+  if (dim != 2 && dim != 3) {
+    rb_raise(rb_eArgError, "dimension must be 2 or 3, got %d", dim);
+  }
+  stride = dim * sizeof(double);
+
+  if (NIL_P(dst)) {
+    dst = src;
+  }
+  rgeo_buffer_get_bytes(src, dst == src, &src_base, &src_size);
+  if (src_size % stride != 0) {
+    rb_raise(rb_eArgError,
+             "buffer size (%" PRIuSIZE
+             " bytes) is not a multiple of %d doubles",
+             src_size, dim);
+  }
+
+  if (dst != src) {
+    rgeo_buffer_get_bytes(dst, 1, &dst_base, &dst_size);
+    if (dst_size < src_size) {
+      rb_raise(rb_eArgError,
+               "output buffer is too small (%" PRIuSIZE " bytes, %" PRIuSIZE
+               " required)",
+               dst_size, src_size);
+    }
+    memmove(dst_base, src_base, src_size);
+  } else {
+    dst_base = src_base;
+  }
+
+  args.data = crs_to_crs_data;
+  args.buffers[0] = dst;
+  args.buffers[1] = dst;
+  args.buffers[2] = dst;
+  args.x = (char *)dst_base;
+  args.y = (char *)dst_base + sizeof(double);
+  args.z = dim == 3 ? (char *)dst_base + 2 * sizeof(double) : NULL;
+  args.stride = stride;
+  args.count = src_size / stride;
+  validity = rgeo_transform_status_prepare(&args, on_error, status);
+  rgeo_crs_to_crs_transform_columns(&args, RTEST(parallel));
+  rgeo_transform_finish(&args, status, validity, "coordinate");
+
+  RB_GC_GUARD(src);
+  RB_GC_GUARD(validity);
+  return Qnil;
+}
+
+// Finds the values of a coordinate column: a String or IO::Buffer holding
+// doubles stride bytes apart, or an [array, schema] pair of addresses of
+// Arrow C Data Interface structures describing a float64 array. buffer is set
+// to the Ruby object holding the values, or Qnil.
+static void rgeo_column_get(VALUE column, int writable, size_t stride,
+                            char **values, size_t *count, VALUE *buffer) {
+  struct ArrowArray *array;
+  struct ArrowSchema *schema;
+  const char *error;
+  double *doubles;
+  void *base;
+  size_t size;
+
+  if (RB_TYPE_P(column, T_ARRAY)) {
+    if (RARRAY_LEN(column) != 2) {
+      rb_raise(rb_eArgError, "Arrow column must be an [array, schema] pair "
+                             "of addresses");
+    }
+    if (stride != sizeof(double)) {
+      rb_raise(rb_eArgError, "Arrow columns hold contiguous doubles");
+    }
+    array = (struct ArrowArray *)(uintptr_t)NUM2ULL(RARRAY_AREF(column, 0));
+    schema = (struct ArrowSchema *)(uintptr_t)NUM2ULL(RARRAY_AREF(column, 1));
+    error = rgeo_arrow_float64_values(array, schema, &doubles, count);
+    if (error) {
+      rb_raise(rb_eArgError, "%s", error);
+    }
+    *values = (char *)doubles;
+    *buffer = Qnil;
+    return;
+  }
+
+  rgeo_buffer_get_bytes(column, writable, &base, &size);
+  if (stride == sizeof(double) && size % stride != 0) {
+    rb_raise(rb_eArgError,
+             "buffer size (%" PRIuSIZE " bytes) is not a multiple of a double",
+             size);
+  }
+  *values = (char *)base;
+  *count = size < sizeof(double) ? 0 : (size - sizeof(double)) / stride + 1;
+  *buffer = column;
+}
+
+// Transforms columns of coordinates, in place or into the out columns,
+// filling status in when it is a TransformStatus.
+static VALUE method_crs_to_crs_transform_columns(VALUE self, VALUE columns,
+                                                 VALUE out, VALUE stride,
+                                                 VALUE parallel,
+                                                 VALUE on_error, VALUE status) {
+  RGeo_CRSToCRSData *crs_to_crs_data;
+  RGeo_TransformBufferArgs args;
+  char *values[RGEO_TRANSFORM_COLUMNS];
+  VALUE validity;
+  VALUE buffer;
+  void *base;
+  size_t size;
+  size_t span;
+  size_t count;
+  long column_count;
+  long i;
+
+  TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
+                       crs_to_crs_data);
+  if (!crs_to_crs_data->crs_to_crs) {
+    return Qnil;
+  }
+
+  Check_Type(columns, T_ARRAY);
+  column_count = RARRAY_LEN(columns);
+  if (column_count != 2 && column_count != 3) {
+    rb_raise(rb_eArgError, "expected 2 or 3 columns, got %ld", column_count);
+  }
+  if (!NIL_P(out)) {
+    Check_Type(out, T_ARRAY);
+    if (RARRAY_LEN(out) != column_count) {
+      rb_raise(rb_eArgError, "expected %ld output columns, got %ld",
+               column_count, RARRAY_LEN(out));
+    }
+  }
+  args.stride = NUM2SIZET(stride);
+  if (args.stride < sizeof(double) || args.stride % sizeof(double) != 0) {
+    rb_raise(rb_eArgError, "stride must be a positive multiple of %d bytes",
+             (int)sizeof(double));
+  }
+
+  args.count = 0;
+  for (i = 0; i < RGEO_TRANSFORM_COLUMNS; i++) {
+    values[i] = NULL;
+    args.buffers[i] = Qnil;
+  }
+  for (i = 0; i < column_count; i++) {
+    rgeo_column_get(RARRAY_AREF(columns, i), NIL_P(out), args.stride,
+                    &values[i], &count, &buffer);
+    if (i > 0 && count != args.count) {
+      rb_raise(rb_eArgError,
+               "columns have different lengths (%" PRIuSIZE " and %" PRIuSIZE
+               ")",
+               args.count, count);
+    }
+    args.count = count;
+    args.buffers[i] = buffer;
+  }
+
+  // Output columns get a copy of the input, with the same stride.
+  if (!NIL_P(out) && args.count > 0) {
+    span = (args.count - 1) * args.stride + sizeof(double);
+    for (i = 0; i < column_count; i++) {
+      buffer = RARRAY_AREF(out, i);
+      rgeo_buffer_get_bytes(buffer, 1, &base, &size);
+      if (size < span) {
+        rb_raise(rb_eArgError,
+                 "output column is too small (%" PRIuSIZE " bytes, %" PRIuSIZE
+                 " required)",
+                 size, span);
+      }
+      memmove(base, values[i], span);
+      values[i] = (char *)base;
+      args.buffers[i] = buffer;
+    }
+  }
+
+  args.data = crs_to_crs_data;
+  args.x = values[0];
+  args.y = values[1];
+  args.z = values[2];
+  validity = rgeo_transform_status_prepare(&args, on_error, status);
+  rgeo_crs_to_crs_transform_columns(&args, RTEST(parallel));
+  rgeo_transform_finish(&args, status, validity, "coordinate");
+
+  RB_GC_GUARD(columns);
+  RB_GC_GUARD(validity);
+  return Qnil;
+}
+
+// Transforms bounding boxes, each one packed as xmin, ymin, xmax and ymax
+// doubles. Their x column is the packed boxes, one every stride bytes.
+typedef struct {
+  RGeo_TransformBufferArgs batch;
+  int densify_pts;
+#ifndef HAVE_PROJ_TRANS_BOUNDS
+  // Points along the edges of a box, x values then y values.
+  double *edges;
+#endif
+} RGeo_TransformBoundsArgs;
+
+#ifndef HAVE_PROJ_TRANS_BOUNDS
+// Number of points sampled along the edges of a box by the fallback of
+// proj_trans_bounds, for PROJ before 8.2.
+static size_t rgeo_bounds_edge_points(int densify_pts) {
+  return 4 * ((size_t)densify_pts + 1);
+}
+
+// Transforms densify_pts points along each edge of the box, in addition to
+// its corners, and returns the envelope of the results. Unlike
+// proj_trans_bounds, it does not look for poles or the antimeridian inside
+// the box.
+static int rgeo_transform_bounds_sample(RGeo_TransformBoundsArgs *args,
+                                        double *box) {
+  RGeo_TransformBufferArgs *batch;
+  size_t segments;
+  size_t count;
+  size_t found;
+  size_t i;
+  double *x;
+  double *y;
+  double t;
+  double dx;
+  double dy;
+
+  batch = &args->batch;
+  segments = (size_t)args->densify_pts + 1;
+  count = rgeo_bounds_edge_points(args->densify_pts);
+  x = args->edges;
+  y = args->edges + count;
+  dx = box[2] - box[0];
+  dy = box[3] - box[1];
+  for (i = 0; i < segments; i++) {
+    t = (double)i / (double)segments;
+    x[i] = box[0] + t * dx;
+    y[i] = box[1];
+    x[segments + i] = box[2];
+    y[segments + i] = box[1] + t * dy;
+    x[2 * segments + i] = box[2] - t * dx;
+    y[2 * segments + i] = box[3];
+    x[3 * segments + i] = box[0];
+    y[3 * segments + i] = box[3] - t * dy;
+  }
+
+  proj_trans_generic(batch->lease.pj, batch->data->direction, x,
+                     sizeof(double), count, y, sizeof(double), count, NULL, 0,
+                     0, NULL, 0, 0);
+  rgeo_stats_add(RGEO_STAT_POINTS_TRANSFORMED, count);
+
+  found = 0;
+  for (i = 0; i < count; i++) {
+    if (x[i] == HUGE_VAL || isnan(x[i]) || isnan(y[i])) {
+      continue;
+    }
+    if (found++ == 0) {
+      box[0] = box[2] = x[i];
+      box[1] = box[3] = y[i];
+      continue;
+    }
+    box[0] = x[i] < box[0] ? x[i] : box[0];
+    box[1] = y[i] < box[1] ? y[i] : box[1];
+    box[2] = x[i] > box[2] ? x[i] : box[2];
+    box[3] = y[i] > box[3] ? y[i] : box[3];
+  }
+  return found > 0;
+}
+#endif
+
+static void *rgeo_transform_bounds(void *ptr) {
+  RGeo_TransformBoundsArgs *args = (RGeo_TransformBoundsArgs *)ptr;
+  RGeo_TransformBufferArgs *batch;
+  double *box;
+  double fill;
+  size_t index;
+  int success;
+  int i;
+
+  batch = &args->batch;
+  while (batch->offset < batch->count && !batch->stopped &&
+         !batch->interrupted) {
+    index = batch->offset;
+    box = (double *)(batch->x + index * batch->stride);
+    if (batch->data->from_radians) {
+      for (i = 0; i < 4; i++) {
+        box[i] *= RGEO_DEGREES_PER_RADIAN;
+      }
+    }
+
+    proj_errno_reset(batch->lease.pj);
+#ifdef HAVE_PROJ_TRANS_BOUNDS
+    success = proj_trans_bounds(
+        batch->lease.ctx, batch->lease.pj, batch->data->direction, box[0],
+        box[1], box[2], box[3], &box[0], &box[1], &box[2], &box[3],
+        args->densify_pts);
+#else
+    success = rgeo_transform_bounds_sample(args, box);
+#endif
+
+    if (success) {
+      if (batch->data->to_radians) {
+        for (i = 0; i < 4; i++) {
+          box[i] *= 1.0 / RGEO_DEGREES_PER_RADIAN;
+        }
+      }
+      if (batch->validity) {
+        batch->validity[index >> 3] |= (unsigned char)(1 << (index & 7));
+      }
+    } else {
+      if (!batch->failures) {
+        batch->failed_index = index;
+        rgeo_transform_error_message(batch);
+      }
+      batch->failures++;
+      rgeo_stats_add(RGEO_STAT_PROJ_ERRORS, 1);
+      fill = batch->on_error == RGEO_ON_ERROR_NAN ? NAN : HUGE_VAL;
+      for (i = 0; i < 4; i++) {
+        box[i] = fill;
+      }
+      if (batch->on_error == RGEO_ON_ERROR_RAISE) {
+        batch->stopped = 1;
+      }
+    }
+    batch->offset++;
+  }
+  return NULL;
+}
+
+static VALUE rgeo_transform_bounds_body(VALUE ptr) {
+  RGeo_TransformBoundsArgs *args = (RGeo_TransformBoundsArgs *)ptr;
+  RGeo_TransformBufferArgs *batch;
+
+  batch = &args->batch;
+#ifndef HAVE_PROJ_TRANS_BOUNDS
+  args->edges = ALLOC_N(double, 2 * rgeo_bounds_edge_points(args->densify_pts));
+#endif
+  rgeo_crs_to_crs_lease(batch->data, &batch->lease);
+  if (!batch->lease.shared) {
+    rgeo_transform_buffers_lock(batch);
+  }
+  while (batch->offset < batch->count && !batch->stopped) {
+    batch->interrupted = 0;
+    rgeo_crs_to_crs_run(&batch->lease, rgeo_transform_bounds, args,
+                        rgeo_transform_buffer_interrupt);
+  }
+  return Qnil;
+}
+
+static VALUE rgeo_transform_bounds_ensure(VALUE ptr) {
+  RGeo_TransformBoundsArgs *args = (RGeo_TransformBoundsArgs *)ptr;
+
+#ifndef HAVE_PROJ_TRANS_BOUNDS
+  FREE(args->edges);
+#endif
+  return rgeo_transform_buffer_ensure((VALUE)&args->batch);
+}
+
+// Transforms a buffer of bounding boxes, in place or into dst, replacing each
+// one with the envelope of its transformed edges, densify_pts points being
+// sampled along each edge in addition to the corners. Fills status in when it
+// is a TransformStatus.
+static VALUE method_crs_to_crs_transform_bounds(VALUE self, VALUE src,
+                                                VALUE dst, VALUE densify_pts,
+                                                VALUE on_error, VALUE status) {
+  RGeo_CRSToCRSData *crs_to_crs_data;
+  RGeo_TransformBoundsArgs args;
+  RGeo_TransformBufferArgs *batch;
+  VALUE validity;
+  size_t stride;
+  void *src_base;
+  void *dst_base;
+  size_t src_size;
+  size_t dst_size;
+  int i;
+
+  TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
+                       crs_to_crs_data);
+  if (!crs_to_crs_data->crs_to_crs) {
+    return Qnil;
+  }
+
+  args.densify_pts = NUM2INT(densify_pts);
+  if (args.densify_pts < 0) {
+    rb_raise(rb_eArgError, "densify_pts must not be negative, got %d",
+             args.densify_pts);
+  }
+  stride = 4 * sizeof(double);
+
+  if (NIL_P(dst)) {
+    dst = src;
+  }
+  rgeo_buffer_get_bytes(src, dst == src, &src_base, &src_size);
+  if (src_size % stride != 0) {
+    rb_raise(rb_eArgError,
+             "buffer size (%" PRIuSIZE " bytes) is not a multiple of 4 doubles",
+             src_size);
+  }
+  if (dst != src) {
+    rgeo_buffer_get_bytes(dst, 1, &dst_base, &dst_size);
+    if (dst_size < src_size) {
+      rb_raise(rb_eArgError,
+               "output buffer is too small (%" PRIuSIZE " bytes, %" PRIuSIZE
+               " required)",
+               dst_size, src_size);
+    }
+    memmove(dst_base, src_base, src_size);
+  } else {
+    dst_base = src_base;
+  }
+
+  batch = &args.batch;
+  batch->data = crs_to_crs_data;
+  batch->lease.ctx = NULL;
+  for (i = 0; i < RGEO_TRANSFORM_COLUMNS; i++) {
+    batch->buffers[i] = dst;
+  }
+  batch->locked = 0;
+  batch->x = (char *)dst_base;
+  batch->y = NULL;
+  batch->z = NULL;
+  batch->stride = stride;
+  batch->count = src_size / stride;
+  batch->offset = 0;
+  batch->interrupted = 0;
+  batch->first = 0;
+  batch->failures = 0;
+  batch->stopped = 0;
+  batch->failed_index = 0;
+  batch->error[0] = '\0';
+#ifndef HAVE_PROJ_TRANS_BOUNDS
+  args.edges = NULL;
+#endif
+  validity = rgeo_transform_status_prepare(batch, on_error, status);
+  rb_ensure(rgeo_transform_bounds_body, (VALUE)&args,
+            rgeo_transform_bounds_ensure, (VALUE)&args);
+  rgeo_transform_finish(batch, status, validity, "box");
+
+  RB_GC_GUARD(src);
+  RB_GC_GUARD(validity);
+  return Qnil;
+}
+
+// Nesting limit for coordinate arrays. GeometryCollections nest to any
+// depth, so this only stops runaway recursion on malformed input.
+#define RGEO_COORDINATES_MAX_DEPTH 64
+
+static int rgeo_coordinates_is_leaf(VALUE coordinates) {
+  return RARRAY_LEN(coordinates) > 0 &&
+         !RB_TYPE_P(RARRAY_AREF(coordinates, 0), T_ARRAY);
+}
+
+// Counts the coordinates in a nested Array as returned by
+// Geometry#coordinates.
+static size_t rgeo_coordinates_count(VALUE coordinates, int depth) {
+  size_t count;
+  long i;
+
+  Check_Type(coordinates, T_ARRAY);
+  if (rgeo_coordinates_is_leaf(coordinates)) {
+    if (RARRAY_LEN(coordinates) < 2) {
+      rb_raise(rb_eArgError, "coordinate must have at least 2 values");
+    }
+    return 1;
+  }
+  if (depth >= RGEO_COORDINATES_MAX_DEPTH) {
+    rb_raise(rb_eArgError, "coordinates are nested too deeply");
+  }
+
+  count = 0;
+  for (i = 0; i < RARRAY_LEN(coordinates); i++) {
+    count += rgeo_coordinates_count(RARRAY_AREF(coordinates, i), depth + 1);
+  }
+  return count;
+}
+
+typedef struct {
+  double *xyz;
+  double *m;
+  size_t index;
+  char from_has_z;
+  char from_has_m;
+  char to_has_z;
+  char to_has_m;
+  VALUE to_factory;
+} RGeo_CoordinatesWalk;
+
+// Packs the x, y and z values of every coordinate into walk->xyz, keeping M
+// values aside in walk->m.
+static void rgeo_coordinates_gather(VALUE coordinates,
+                                    RGeo_CoordinatesWalk *walk) {
+  double *xyz;
+  long len;
+  long i;
+
+  if (!rgeo_coordinates_is_leaf(coordinates)) {
+    for (i = 0; i < RARRAY_LEN(coordinates); i++) {
+      rgeo_coordinates_gather(RARRAY_AREF(coordinates, i), walk);
+    }
+    return;
+  }
+
+  len = RARRAY_LEN(coordinates);
+  xyz = walk->xyz + walk->index * 3;
+  xyz[0] = rb_num2dbl(RARRAY_AREF(coordinates, 0));
+  xyz[1] = rb_num2dbl(RARRAY_AREF(coordinates, 1));
+  xyz[2] = walk->from_has_z && len > 2
+               ? rb_num2dbl(RARRAY_AREF(coordinates, 2))
+               : 0.0;
+  if (walk->m) {
+    i = walk->from_has_z ? 3 : 2;
+    walk->m[walk->index] =
+        len > i ? rb_num2dbl(RARRAY_AREF(coordinates, i)) : 0.0;
+  }
+  walk->index++;
+}
+
+// Rebuilds the nested Array, replacing each coordinate with a point made by
+// the target factory from the transformed values.
+static VALUE rgeo_coordinates_build(VALUE coordinates,
+                                    RGeo_CoordinatesWalk *walk) {
+  VALUE result;
+  VALUE args[4];
+  double *xyz;
+  int argc;
+  long i;
+
+  if (!rgeo_coordinates_is_leaf(coordinates)) {
+    result = rb_ary_new_capa(RARRAY_LEN(coordinates));
+    for (i = 0; i < RARRAY_LEN(coordinates); i++) {
+      rb_ary_push(result,
+                  rgeo_coordinates_build(RARRAY_AREF(coordinates, i), walk));
+    }
+    return result;
+  }
+
+  xyz = walk->xyz + walk->index * 3;
+  argc = 0;
+  args[argc++] = DBL2NUM(xyz[0]);
+  args[argc++] = DBL2NUM(xyz[1]);
+  if (walk->to_has_z) {
+    args[argc++] = DBL2NUM(walk->from_has_z ? xyz[2] : 0.0);
+  }
+  if (walk->to_has_m) {
+    args[argc++] = DBL2NUM(walk->m ? walk->m[walk->index] : 0.0);
+  }
+  walk->index++;
+  return rb_funcallv(walk->to_factory, rb_intern("point"), argc, args);
+}
+
+static int rgeo_factory_property(VALUE factory, const char *name) {
+  return RTEST(
+      rb_funcall(factory, rb_intern("property"), 1, ID2SYM(rb_intern(name))));
+}
+
+// Transforms the nested Array returned by Geometry#coordinates into the
+// points of to_factory, nested the same way, filling status in when it is a
+// TransformStatus.
+static VALUE method_crs_to_crs_transform_coordinates(
+    VALUE self, VALUE coordinates, VALUE from_factory, VALUE to_factory,
+    VALUE on_error, VALUE status) {
+  RGeo_CRSToCRSData *crs_to_crs_data;
+  RGeo_CoordinatesWalk walk;
+  VALUE result;
+  VALUE xyz_buffer;
+  VALUE m_buffer;
+  size_t count;
 
-  result = Qnil;
   TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
                        crs_to_crs_data);
-  crs_to_crs_pj = crs_to_crs_data->crs_to_crs;
-  if (crs_to_crs_pj) {
-    xval = rb_num2dbl(x);
-    yval = rb_num2dbl(y);
-    zval = NIL_P(z) ? 0.0 : rb_num2dbl(z);
+  if (!crs_to_crs_data->crs_to_crs) {
+    return Qnil;
+  }
 
-    input = proj_coord(xval, yval, zval, HUGE_VAL);
-    output = proj_trans(crs_to_crs_pj, PJ_FWD, input);
+  count = rgeo_coordinates_count(coordinates, 0);
+
+  walk.from_has_z = rgeo_factory_property(from_factory, "has_z_coordinate");
+  walk.from_has_m = rgeo_factory_property(from_factory, "has_m_coordinate");
+  walk.to_has_z = rgeo_factory_property(to_factory, "has_z_coordinate");
+  walk.to_has_m = rgeo_factory_property(to_factory, "has_m_coordinate");
+  walk.to_factory = to_factory;
+
+  // Strings are used as scratch buffers so that the GC reclaims them if
+  // reading a coordinate or building a point raises.
+  xyz_buffer = rb_str_new(NULL, count * 3 * sizeof(double));
+  walk.xyz = (double *)RSTRING_PTR(xyz_buffer);
+  m_buffer = Qnil;
+  walk.m = NULL;
+  if (walk.from_has_m && walk.to_has_m) {
+    m_buffer = rb_str_new(NULL, count * sizeof(double));
+    walk.m = (double *)RSTRING_PTR(m_buffer);
+  }
 
-    result = rb_ary_new2(NIL_P(z) ? 2 : 3);
-    rb_ary_push(result, DBL2NUM(output.xyz.x));
-    rb_ary_push(result, DBL2NUM(output.xyz.y));
-    if (!NIL_P(z)) {
-      rb_ary_push(result, DBL2NUM(output.xyz.z));
+  walk.index = 0;
+  rgeo_coordinates_gather(coordinates, &walk);
+  rgeo_crs_to_crs_transform_coords(crs_to_crs_data, xyz_buffer, walk.xyz,
+                                   count, walk.from_has_z, on_error, status);
+  walk.index = 0;
+
+  result = rgeo_coordinates_build(coordinates, &walk);
+
+  RB_GC_GUARD(xyz_buffer);
+  RB_GC_GUARD(m_buffer);
+  return result;
+}
+
+// Batch transformed on the worker threads while the calling thread or fiber
+// goes on. The coordinates are copied into memory owned by the job, so that
+// no Ruby object is touched while it runs, and handed back when its result
+// is collected. Completion is signalled by writing a byte to a pipe, which
+// the caller waits on like any other IO.
+typedef struct RGeo_AsyncJob {
+  VALUE self;
+  // Keeps the pipeline of batch alive.
+  VALUE crs_to_crs;
+  RGeo_TransformBufferArgs batch;
+  // Parts of batch leased for the worker threads, NULL once gathered.
+  RGeo_TransformBufferArgs *parts;
+  size_t part_count;
+  double *coords;
+  size_t dimension;
+  unsigned char *validity;
+  // Write end of the completion pipe, closed once written to.
+  int fd;
+  // Set by the last worker, under async_lock.
+  char done;
+  char collected;
+  // Buffer receiving the results of a buffer job, or Qnil, and the
+  // TransformStatus filled in when it is collected, or Qnil.
+  VALUE dst;
+  VALUE status;
+  // Coordinates of a geometry job, rebuilt with walk.to_factory, or Qnil.
+  VALUE coordinates;
+  RGeo_CoordinatesWalk walk;
+  // Outcome returned or raised by TransformFuture#value.
+  VALUE result;
+  VALUE error;
+  struct RGeo_AsyncJob *prev_job;
+  struct RGeo_AsyncJob *next_job;
+} RGeo_AsyncJob;
+
+static VALUE rgeo_transform_future_class;
+
+// Jobs still running. They are marked through async_registry, so that a
+// job and what its workers use are not collected before they are done, even
+// when nothing waits for it anymore.
+static rb_nativethread_lock_t async_lock;
+static RGeo_AsyncJob *async_jobs;
+static VALUE async_registry;
+
+static void rgeo_async_registry_mark(void *ptr) {
+  RGeo_AsyncJob *job;
+
+  rb_nativethread_lock_lock(&async_lock);
+  for (job = async_jobs; job; job = job->next_job) {
+    rb_gc_mark(job->self);
+  }
+  rb_nativethread_lock_unlock(&async_lock);
+}
+
+static const rb_data_type_t rgeo_async_registry_type = {
+    "RGeo::CoordSys::AsyncRegistry",
+    {rgeo_async_registry_mark, NULL, NULL},
+    0,
+    0,
+    RUBY_TYPED_FREE_IMMEDIATELY};
+
+// Hands the leases of the parts back and adds their outcome to the batch.
+static void rgeo_async_job_gather(RGeo_AsyncJob *job) {
+  RGeo_TransformPartsArgs parts_args;
+  size_t i;
+
+  if (!job->parts) {
+    return;
+  }
+  parts_args.batch = &job->batch;
+  parts_args.parts = job->parts;
+  parts_args.part_count = job->part_count;
+  rgeo_transform_parts_gather(&parts_args);
+  for (i = 0; i < job->part_count; i++) {
+    rgeo_crs_to_crs_unlease(&job->parts[i].lease);
+  }
+  FREE(job->parts);
+  job->parts = NULL;
+}
+
+// Frees the copies of the coordinates once they are not needed anymore.
+static void rgeo_async_job_clear(RGeo_AsyncJob *job) {
+  FREE(job->coords);
+  FREE(job->walk.m);
+  FREE(job->validity);
+  job->coords = NULL;
+  job->walk.m = NULL;
+  job->validity = NULL;
+}
+
+// Running jobs are never collected, see async_registry.
+static void rgeo_async_job_free(void *ptr) {
+  RGeo_AsyncJob *job = (RGeo_AsyncJob *)ptr;
+
+  if (job->parts) {
+    rgeo_async_job_gather(job);
+  }
+  rgeo_async_job_clear(job);
+  if (job->fd >= 0) {
+    close(job->fd);
+  }
+  FREE(job);
+}
+
+static size_t rgeo_async_job_memsize(const void *ptr) {
+  size_t size = 0;
+  const RGeo_AsyncJob *job = (const RGeo_AsyncJob *)ptr;
+
+  size += sizeof(*job);
+  if (job->parts) {
+    size += job->part_count * sizeof(RGeo_TransformBufferArgs);
+  }
+  if (job->coords) {
+    size += job->batch.count * job->dimension * sizeof(double);
+  }
+  if (job->walk.m) {
+    size += job->batch.count * sizeof(double);
+  }
+  if (job->validity) {
+    size += (job->batch.count + 7) / 8;
+  }
+  return size;
+}
+
+static void rgeo_async_job_mark(void *ptr) {
+  RGeo_AsyncJob *job = (RGeo_AsyncJob *)ptr;
+
+  rb_gc_mark(job->crs_to_crs);
+  rb_gc_mark(job->dst);
+  rb_gc_mark(job->status);
+  rb_gc_mark(job->coordinates);
+  rb_gc_mark(job->walk.to_factory);
+  rb_gc_mark(job->result);
+  rb_gc_mark(job->error);
+}
+
+static const rb_data_type_t rgeo_async_job_type = {
+    "RGeo::CoordSys::TransformFuture",
+    {rgeo_async_job_mark, rgeo_async_job_free, rgeo_async_job_memsize},
+    0,
+    0,
+    RUBY_TYPED_FREE_IMMEDIATELY};
+
+static RGeo_AsyncJob *rgeo_async_job_get(VALUE self) {
+  RGeo_AsyncJob *job;
+
+  TypedData_Get_Struct(self, RGeo_AsyncJob, &rgeo_async_job_type, job);
+  return job;
+}
+
+// Creates the TransformFuture of a job transforming count coordinates of
+// dimension values with the pipeline of crs_to_crs, and signalling its
+// completion through the IO writer, which the caller may close once the job
+// is submitted.
+static VALUE rgeo_async_job_new(VALUE crs_to_crs, RGeo_CRSToCRSData *data,
+                                VALUE writer, size_t count,
+                                size_t dimension) {
+  RGeo_AsyncJob *job;
+  RGeo_TransformBufferArgs *args;
+  VALUE self;
+  int fd;
+
+  job = ALLOC(RGeo_AsyncJob);
+  job->crs_to_crs = crs_to_crs;
+  job->parts = NULL;
+  job->part_count = 0;
+  job->coords = NULL;
+  job->dimension = dimension;
+  job->validity = NULL;
+  job->fd = -1;
+  job->done = 0;
+  job->collected = 0;
+  job->dst = Qnil;
+  job->status = Qnil;
+  job->coordinates = Qnil;
+  job->walk.m = NULL;
+  job->walk.to_factory = Qnil;
+  job->result = Qnil;
+  job->error = Qnil;
+  job->prev_job = NULL;
+  job->next_job = NULL;
+  self = TypedData_Wrap_Struct(rgeo_transform_future_class,
+                               &rgeo_async_job_type, job);
+  job->self = self;
+
+  job->coords = ALLOC_N(double, count * dimension);
+  args = &job->batch;
+  args->data = data;
+  args->buffers[0] = Qnil;
+  args->buffers[1] = Qnil;
+  args->buffers[2] = Qnil;
+  args->x = (char *)job->coords;
+  args->y = (char *)(job->coords + 1);
+  args->z = dimension == 3 ? (char *)(job->coords + 2) : NULL;
+  args->stride = dimension * sizeof(double);
+  args->count = count;
+  args->on_error = RGEO_ON_ERROR_KEEP;
+  args->validity = NULL;
+  rgeo_transform_args_reset(args);
+
+  // The job writes to its own descriptor, as the IO may be closed or
+  // collected before the workers are done.
+  fd = rb_cloexec_dup(NUM2INT(rb_funcall(writer, rb_intern("fileno"), 0)));
+  if (fd < 0) {
+    rb_sys_fail("dup");
+  }
+  rb_update_max_fd(fd);
+  job->fd = fd;
+
+  RB_GC_GUARD(self);
+  return self;
+}
+
+static void rgeo_async_job_part(void *ptr, size_t index) {
+  RGeo_AsyncJob *job = (RGeo_AsyncJob *)ptr;
+  rgeo_transform_buffer(&job->parts[index]);
+}
+
+// Called once every part is done, without the GVL when run by a worker.
+static void rgeo_async_job_done(void *ptr) {
+  RGeo_AsyncJob *job = (RGeo_AsyncJob *)ptr;
+  char byte;
+  int fd;
+
+  rb_nativethread_lock_lock(&async_lock);
+  if (job->prev_job) {
+    job->prev_job->next_job = job->next_job;
+  } else if (async_jobs == job) {
+    async_jobs = job->next_job;
+  }
+  if (job->next_job) {
+    job->next_job->prev_job = job->prev_job;
+  }
+  job->done = 1;
+  fd = job->fd;
+  job->fd = -1;
+  rb_nativethread_lock_unlock(&async_lock);
+
+  // The job may be collected from here on.
+  byte = 1;
+  if (write(fd, &byte, 1) != 1) {
+    // The read end was closed, nothing waits for the job anymore.
+  }
+  close(fd);
+}
+
+// Transforms the parts of job one after the other on the calling thread.
+static VALUE rgeo_async_job_run_body(VALUE ptr) {
+  RGeo_AsyncJob *job = (RGeo_AsyncJob *)ptr;
+  RGeo_TransformBufferArgs *part;
+  size_t i;
+
+  for (i = 0; i < job->part_count; i++) {
+    part = &job->parts[i];
+    while (part->offset < part->count && !part->stopped) {
+      part->interrupted = 0;
+      rgeo_crs_to_crs_run(&part->lease, rgeo_transform_buffer, part,
+                          rgeo_transform_buffer_interrupt);
+    }
+  }
+  return Qnil;
+}
+
+// Completes job even when an interrupt raised while it was running, so that
+// it does not stay registered with its leases and nothing waits for it
+// forever.
+static VALUE rgeo_async_job_run_ensure(VALUE ptr) {
+  RGeo_AsyncJob *job = (RGeo_AsyncJob *)ptr;
+
+  rgeo_async_job_gather(job);
+  rgeo_async_job_done(job);
+  return Qnil;
+}
+
+// Transforms the coordinates of job on the worker threads. When the
+// pipeline cannot be cloned or no worker can be started, they are
+// transformed before returning, as a synchronous call would.
+static void rgeo_async_job_submit(RGeo_AsyncJob *job) {
+  RGeo_TransformBufferArgs *args;
+  RGeo_TransformBufferArgs *part;
+  size_t part_size;
+  int shared;
+  size_t i;
+
+  args = &job->batch;
+  if (args->data->kernel.type == RGEO_KERNEL_IDENTITY) {
+    args->lease.pj = NULL;
+    rgeo_stats_add(RGEO_STAT_POINTS_TRANSFORMED, args->count);
+    rgeo_transform_check(args, args->x, args->y, args->z, args->count);
+    rgeo_async_job_done(job);
+    return;
+  }
+
+  job->part_count = rgeo_transform_part_count(args, 1, &part_size);
+  job->parts = rgeo_transform_parts_split(args, job->part_count, part_size);
+  shared = 0;
+  for (i = 0; i < job->part_count; i++) {
+    part = &job->parts[i];
+    rgeo_crs_to_crs_lease(part->data, &part->lease);
+    shared |= part->lease.shared;
+  }
+
+  rb_nativethread_lock_lock(&async_lock);
+  job->next_job = async_jobs;
+  if (async_jobs) {
+    async_jobs->prev_job = job;
+  }
+  async_jobs = job;
+  rb_nativethread_lock_unlock(&async_lock);
+
+  if (!shared && rgeo_workers_submit(rgeo_async_job_part, job,
+                                     job->part_count, rgeo_async_job_done)) {
+    return;
+  }
+  rb_ensure(rgeo_async_job_run_body, (VALUE)job, rgeo_async_job_run_ensure,
+            (VALUE)job);
+}
+
+// Starts transforming a buffer of interleaved coordinates, as
+// _transform_buffer does, writing the results into dst when collected.
+static VALUE method_crs_to_crs_transform_buffer_async(
+    VALUE self, VALUE src, VALUE dst, VALUE dimension, VALUE on_error,
+    VALUE status, VALUE writer) {
+  RGeo_CRSToCRSData *crs_to_crs_data;
+  RGeo_AsyncJob *job;
+  VALUE result;
+  int dim;
+  size_t stride;
+  void *src_base;
+  void *dst_base;
+  size_t src_size;
+  size_t dst_size;
+
+  TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
+                       crs_to_crs_data);
+  if (!crs_to_crs_data->crs_to_crs) {
+    return Qnil;
+  }
+
+  Check_Type(dimension, T_FIXNUM);
+  dim = FIX2INT(dimension);
+  if (dim != 2 && dim != 3) {
+    rb_raise(rb_eArgError, "dimension must be 2 or 3, got %d", dim);
+  }
+  stride = dim * sizeof(double);
+
+  if (NIL_P(dst)) {
+    dst = src;
+  }
+  rgeo_buffer_get_bytes(src, 0, &src_base, &src_size);
+  if (src_size % stride != 0) {
+    rb_raise(rb_eArgError,
+             "buffer size (%" PRIuSIZE
+             " bytes) is not a multiple of %d doubles",
+             src_size, dim);
+  }
+  rgeo_buffer_get_bytes(dst, 1, &dst_base, &dst_size);
+  if (dst_size < src_size) {
+    rb_raise(rb_eArgError,
+             "output buffer is too small (%" PRIuSIZE " bytes, %" PRIuSIZE
+             " required)",
+             dst_size, src_size);
+  }
+
+  result = rgeo_async_job_new(self, crs_to_crs_data, writer,
+                              src_size / stride, dim);
+  job = rgeo_async_job_get(result);
+  job->dst = dst;
+  job->status = status;
+  job->batch.on_error = rgeo_on_error_get(on_error);
+  if (!NIL_P(status)) {
+    job->validity = ZALLOC_N(unsigned char, (job->batch.count + 7) / 8);
+    job->batch.validity = job->validity;
+  }
+  // The allocations above may have run the GC and moved the bytes of src.
+  rgeo_buffer_get_bytes(src, 0, &src_base, &src_size);
+  memcpy(job->coords, src_base, src_size);
+  rgeo_async_job_submit(job);
+
+  RB_GC_GUARD(src);
+  RB_GC_GUARD(result);
+  return result;
+}
+
+// Starts transforming the nested Array returned by Geometry#coordinates, as
+// _transform_coordinates does.
+static VALUE method_crs_to_crs_transform_coordinates_async(
+    VALUE self, VALUE coordinates, VALUE from_factory, VALUE to_factory,
+    VALUE writer) {
+  RGeo_CRSToCRSData *crs_to_crs_data;
+  RGeo_CoordinatesWalk *walk;
+  RGeo_AsyncJob *job;
+  VALUE result;
+  size_t count;
+
+  TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
+                       crs_to_crs_data);
+  if (!crs_to_crs_data->crs_to_crs) {
+    return Qnil;
+  }
+
+  count = rgeo_coordinates_count(coordinates, 0);
+  result = rgeo_async_job_new(self, crs_to_crs_data, writer, count, 3);
+  job = rgeo_async_job_get(result);
+  job->coordinates = coordinates;
+
+  walk = &job->walk;
+  walk->from_has_z = rgeo_factory_property(from_factory, "has_z_coordinate");
+  walk->from_has_m = rgeo_factory_property(from_factory, "has_m_coordinate");
+  walk->to_has_z = rgeo_factory_property(to_factory, "has_z_coordinate");
+  walk->to_has_m = rgeo_factory_property(to_factory, "has_m_coordinate");
+  walk->to_factory = to_factory;
+  walk->xyz = job->coords;
+  if (!walk->from_has_z) {
+    job->batch.z = NULL;
+  }
+  if (walk->from_has_m && walk->to_has_m) {
+    walk->m = ALLOC_N(double, count);
+  }
+
+  walk->index = 0;
+  rgeo_coordinates_gather(coordinates, walk);
+  rgeo_async_job_submit(job);
+
+  RB_GC_GUARD(result);
+  return result;
+}
+
+static VALUE method_transform_future_is_done(VALUE self) {
+  RGeo_AsyncJob *job;
+  char done;
+
+  job = rgeo_async_job_get(self);
+  rb_nativethread_lock_lock(&async_lock);
+  done = job->done;
+  rb_nativethread_lock_unlock(&async_lock);
+  return done ? Qtrue : Qfalse;
+}
+
+// Returns the outcome of a job that is done: the output buffer of a buffer
+// job, once the results are written to it and its status is filled in, or
+// the coordinates of a geometry job rebuilt as points. Raises
+// RGeo::Error::TransformError when a failure stopped the job.
+static VALUE method_transform_future_value(VALUE self) {
+  RGeo_AsyncJob *job;
+  RGeo_TransformBufferArgs *args;
+  VALUE validity;
+  void *dst_base;
+  size_t dst_size;
+  size_t size;
+
+  job = rgeo_async_job_get(self);
+  if (!job->collected) {
+    if (!RTEST(method_transform_future_is_done(self))) {
+      rb_raise(rb_eRuntimeError, "transformation is still running");
+    }
+    args = &job->batch;
+    rgeo_async_job_gather(job);
+
+    validity = Qnil;
+    if (!NIL_P(job->dst)) {
+      size = args->count * args->stride;
+      rgeo_buffer_get_bytes(job->dst, 1, &dst_base, &dst_size);
+      if (dst_size < size) {
+        rb_raise(rb_eArgError,
+                 "output buffer was shrunk (%" PRIuSIZE " bytes, %" PRIuSIZE
+                 " required)",
+                 dst_size, size);
+      }
+      memcpy(dst_base, job->coords, size);
+      if (job->validity) {
+        validity = rb_str_new((const char *)job->validity,
+                              (args->count + 7) / 8);
+      }
+      job->result = job->dst;
+    } else {
+      job->walk.index = 0;
+      job->result = rgeo_coordinates_build(job->coordinates, &job->walk);
+    }
+    if (args->stopped) {
+      job->error = rgeo_transform_error_new(args, "coordinate");
+    }
+    job->collected = 1;
+    rgeo_async_job_clear(job);
+    rgeo_transform_status_fill(args, job->status, validity);
+  }
+
+  if (!NIL_P(job->error)) {
+    rb_exc_raise(job->error);
+  }
+  return job->result;
+}
+
+typedef struct {
+  double *xyz;
+  size_t index;
+  // Set when a coordinate sequence of the geometry has a Z.
+  int has_z;
+} RGeo_WKBCoords;
+
+static void rgeo_wkb_count_coords(unsigned char *coords, size_t count,
+                                  int dimension, int has_z, int swap,
+                                  void *arg) {
+  RGeo_WKBCoords *wkb_coords = (RGeo_WKBCoords *)arg;
+
+  wkb_coords->index += count;
+  wkb_coords->has_z |= has_z;
+}
+
+static void rgeo_wkb_gather_coords(unsigned char *coords, size_t count,
+                                   int dimension, int has_z, int swap,
+                                   void *arg) {
+  RGeo_WKBCoords *wkb_coords = (RGeo_WKBCoords *)arg;
+  double *xyz;
+  size_t i;
+
+  for (i = 0; i < count; i++, coords += dimension * sizeof(double)) {
+    xyz = wkb_coords->xyz + 3 * wkb_coords->index++;
+    xyz[0] = rgeo_wkb_get_double(coords, swap);
+    xyz[1] = rgeo_wkb_get_double(coords + sizeof(double), swap);
+    xyz[2] = has_z ? rgeo_wkb_get_double(coords + 2 * sizeof(double), swap)
+                   : 0.0;
+  }
+}
+
+// Writes the transformed coordinates back in place. Empty points, stored as
+// NaN coordinates, are left untouched.
+static void rgeo_wkb_scatter_coords(unsigned char *coords, size_t count,
+                                    int dimension, int has_z, int swap,
+                                    void *arg) {
+  RGeo_WKBCoords *wkb_coords = (RGeo_WKBCoords *)arg;
+  double *xyz;
+  size_t i;
+
+  for (i = 0; i < count; i++, coords += dimension * sizeof(double)) {
+    xyz = wkb_coords->xyz + 3 * wkb_coords->index++;
+    if (isnan(rgeo_wkb_get_double(coords, swap))) {
+      continue;
     }
+    rgeo_wkb_put_double(coords, xyz[0], swap);
+    rgeo_wkb_put_double(coords + sizeof(double), xyz[1], swap);
+    if (has_z) {
+      rgeo_wkb_put_double(coords + 2 * sizeof(double), xyz[2], swap);
+    }
+  }
+}
+
+// Copies the WKB held by str, rewriting the SRID of its top-level geometry:
+// srid is false to keep the header as is, nil to remove the SRID, or the
+// SRID to write (added to the header if missing).
+static VALUE rgeo_wkb_copy(VALUE str, VALUE srid) {
+  RGeo_WKBHeader header;
+  const unsigned char *in;
+  unsigned char *out;
+  const char *error;
+  size_t size;
+  VALUE result;
+
+  in = (const unsigned char *)RSTRING_PTR(str);
+  size = RSTRING_LEN(str);
+  error = rgeo_wkb_read_header(in, size, &header);
+  if (error) {
+    rb_raise(rb_eArgError, "invalid WKB: %s", error);
+  }
+
+  if (srid == Qfalse || (NIL_P(srid) && !header.has_srid)) {
+    result = rb_str_new((const char *)in, size);
+  } else if (NIL_P(srid)) {
+    result = rb_str_new(NULL, size - 4);
+    out = (unsigned char *)RSTRING_PTR(result);
+    memcpy(out, in, 5);
+    rgeo_wkb_put_uint32(out + 1, header.type & ~RGEO_EWKB_SRID_FLAG,
+                        header.swap);
+    memcpy(out + 5, in + 9, size - 9);
+  } else if (header.has_srid) {
+    result = rb_str_new((const char *)in, size);
+    out = (unsigned char *)RSTRING_PTR(result);
+    rgeo_wkb_put_uint32(out + 5, NUM2UINT(srid), header.swap);
+  } else {
+    result = rb_str_new(NULL, size + 4);
+    out = (unsigned char *)RSTRING_PTR(result);
+    memcpy(out, in, 5);
+    rgeo_wkb_put_uint32(out + 1, header.type | RGEO_EWKB_SRID_FLAG,
+                        header.swap);
+    rgeo_wkb_put_uint32(out + 5, NUM2UINT(srid), header.swap);
+    memcpy(out + 9, in + 5, size - 5);
+  }
+  return result;
+}
+
+// Transforms the coordinates of a WKB or EWKB geometry into a new binary
+// String, without building any Ruby object per coordinate. See
+// rgeo_wkb_copy for srid. Fills status in when it is a TransformStatus.
+static VALUE method_crs_to_crs_transform_wkb(VALUE self, VALUE wkb,
+                                             VALUE srid, VALUE on_error,
+                                             VALUE status) {
+  RGeo_CRSToCRSData *crs_to_crs_data;
+  RGeo_WKBCoords wkb_coords;
+  const char *error;
+  unsigned char *bytes;
+  size_t size;
+  size_t count;
+  VALUE result;
+  VALUE xyz_buffer;
+
+  TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
+                       crs_to_crs_data);
+  if (!crs_to_crs_data->crs_to_crs) {
+    return Qnil;
   }
+  StringValue(wkb);
+
+  result = rgeo_wkb_copy(wkb, srid);
+  bytes = (unsigned char *)RSTRING_PTR(result);
+  size = RSTRING_LEN(result);
+
+  wkb_coords.index = 0;
+  wkb_coords.has_z = 0;
+  error = rgeo_wkb_walk(bytes, size, rgeo_wkb_count_coords, &wkb_coords);
+  if (error) {
+    rb_raise(rb_eArgError, "invalid WKB: %s", error);
+  }
+  count = wkb_coords.index;
+
+  // As in _transform_coordinates, a String holds the scratch buffer.
+  xyz_buffer = rb_str_new(NULL, count * 3 * sizeof(double));
+  wkb_coords.xyz = (double *)RSTRING_PTR(xyz_buffer);
+  wkb_coords.index = 0;
+  rgeo_wkb_walk(bytes, size, rgeo_wkb_gather_coords, &wkb_coords);
+
+  rgeo_crs_to_crs_transform_coords(crs_to_crs_data, xyz_buffer,
+                                   wkb_coords.xyz, count, wkb_coords.has_z,
+                                   on_error, status);
+
+  wkb_coords.index = 0;
+  rgeo_wkb_walk(bytes, size, rgeo_wkb_scatter_coords, &wkb_coords);
+
+  RB_GC_GUARD(xyz_buffer);
   return result;
 }
 
@@ -501,18 +3344,13 @@ static VALUE method_crs_to_crs_wkt_str(VALUE self) {
   VALUE result;
   RGeo_CRSToCRSData *crs_to_crs_data;
   PJ *crs_to_crs_pj;
-  const char *str;
 
   result = Qnil;
   TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
                        crs_to_crs_data);
   crs_to_crs_pj = crs_to_crs_data->crs_to_crs;
   if (crs_to_crs_pj) {
-    const char *const options[] = {"MULTILINE=NO", NULL};
-    str = proj_as_wkt(local_proj_context, crs_to_crs_pj, WKT_TYPE, options);
-    if (str) {
-      result = rb_str_new2(str);
-    }
+    result = rgeo_pj_export_str(crs_to_crs_pj, RGEO_EXPORT_WKT);
   }
   return result;
 }
@@ -521,21 +3359,61 @@ static VALUE method_crs_to_crs_area_of_use_str(VALUE self) {
   VALUE result;
   RGeo_CRSToCRSData *crs_to_crs_data;
   PJ *crs_to_crs_pj;
+  PJ_CONTEXT *ctx;
   const char *str;
+  int found;
 
   result = Qnil;
   TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
                        crs_to_crs_data);
   crs_to_crs_pj = crs_to_crs_data->crs_to_crs;
   if (crs_to_crs_pj) {
-    if (proj_get_area_of_use(local_proj_context, crs_to_crs_pj, NULL, NULL,
-                             NULL, NULL, &str)) {
+    ctx = rgeo_proj_context_acquire();
+    found = proj_get_area_of_use(ctx, crs_to_crs_pj, NULL, NULL, NULL, NULL,
+                                 &str);
+    rgeo_proj_context_release(ctx);
+    if (found) {
       result = rb_str_new2(str);
     }
   }
   return result;
 }
 
+// Returns the [name, accuracy, grid_count, ballpark] description of the
+// operation run by the pipeline. name is nil and accuracy is nil when
+// unknown, as happens when PROJ kept several candidate operations.
+static VALUE method_crs_to_crs_operation(VALUE self) {
+  VALUE result;
+  RGeo_CRSToCRSData *crs_to_crs_data;
+  PJ *crs_to_crs_pj;
+  PJ_CONTEXT *ctx;
+  const char *name;
+  double accuracy;
+  int grids;
+  int ballpark;
+
+  result = Qnil;
+  TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
+                       crs_to_crs_data);
+  crs_to_crs_pj = crs_to_crs_data->crs_to_crs;
+  if (crs_to_crs_pj) {
+    ctx = rgeo_proj_context_acquire();
+    name = proj_get_name(crs_to_crs_pj);
+    accuracy = proj_coordoperation_get_accuracy(ctx, crs_to_crs_pj);
+    grids = proj_coordoperation_get_grid_used_count(ctx, crs_to_crs_pj);
+    ballpark =
+        proj_coordoperation_has_ballpark_transformation(ctx, crs_to_crs_pj);
+    rgeo_proj_context_release(ctx);
+
+    result = rb_ary_new_capa(4);
+    rb_ary_push(result, name ? rb_str_new_cstr(name) : Qnil);
+    rb_ary_push(result, accuracy >= 0 ? DBL2NUM(accuracy) : Qnil);
+    rb_ary_push(result, INT2FIX(grids));
+    rb_ary_push(result, ballpark ? Qtrue : Qfalse);
+  }
+  return result;
+}
+
 static VALUE method_crs_to_crs_proj_type(VALUE self) {
   VALUE result;
   RGeo_CRSToCRSData *crs_to_crs_data;
@@ -553,6 +3431,17 @@ static VALUE method_crs_to_crs_proj_type(VALUE self) {
   return result;
 }
 
+// Returns the name of the kernel replacing the pipeline, or nil.
+static VALUE method_crs_to_crs_fast_path(VALUE self) {
+  RGeo_CRSToCRSData *crs_to_crs_data;
+  const char *name;
+
+  TypedData_Get_Struct(self, RGeo_CRSToCRSData, &rgeo_crs_to_crs_data_type,
+                       crs_to_crs_data);
+  name = rgeo_kernel_name(&crs_to_crs_data->kernel);
+  return name ? ID2SYM(rb_intern(name)) : Qnil;
+}
+
 static VALUE method_crs_to_crs_identity(VALUE self, VALUE from, VALUE to) {
   VALUE result;
   RGeo_Proj4Data *from_data;
@@ -563,8 +3452,8 @@ static VALUE method_crs_to_crs_identity(VALUE self, VALUE from, VALUE to) {
 
   result = Qfalse;
 
-  TypedData_Get_Struct(from, RGeo_Proj4Data, &rgeo_proj4_data_type, from_data);
-  TypedData_Get_Struct(to, RGeo_Proj4Data, &rgeo_proj4_data_type, to_data);
+  from_data = rgeo_proj4_get(from);
+  to_data = rgeo_proj4_get(to);
   from_pj = from_data->pj;
   to_pj = to_data->pj;
 
@@ -599,13 +3488,16 @@ static void rgeo_init_proj4() {
   proj4_class =
       rb_define_class_under(coordsys_module, "Proj4", coordinate_system_class);
   rb_define_alloc_func(proj4_class, rgeo_proj4_data_alloc);
-  rb_define_module_function(proj4_class, "_create", cmethod_proj4_create, 2);
+  rb_define_module_function(proj4_class, "_create", cmethod_proj4_create, 3);
   rb_define_method(proj4_class, "initialize_copy", method_proj4_initialize_copy,
                    1);
-  rb_define_method(proj4_class, "_set_value", method_proj4_set_value, 2);
   rb_define_method(proj4_class, "_original_str", method_proj4_original_str, 0);
+  rb_define_method(proj4_class, "_set_original_str",
+                   method_proj4_set_original_str, 1);
   rb_define_method(proj4_class, "_canonical_str", method_proj4_canonical_str,
                    0);
+  rb_define_method(proj4_class, "_fingerprint", method_proj4_fingerprint, 0);
+  rb_define_method(proj4_class, "_eql?", method_proj4_eql, 1);
   rb_define_method(proj4_class, "_as_text", method_proj4_wkt_str, 0);
   rb_define_method(proj4_class, "_auth_name", method_proj4_auth_name_str, 0);
   rb_define_method(proj4_class, "_valid?", method_proj4_is_valid, 0);
@@ -616,11 +3508,18 @@ static void rgeo_init_proj4() {
   rb_define_method(proj4_class, "_get_geographic", method_proj4_get_geographic,
                    0);
   rb_define_method(proj4_class, "_crs?", method_proj4_is_crs, 0);
+  rb_define_method(proj4_class, "_resolved?", method_proj4_is_resolved, 0);
   rb_define_method(proj4_class, "_axis_and_unit_info",
-                   method_proj4_axis_and_unit_info_str, 1);
+                   method_proj4_axis_and_unit_info, 1);
   rb_define_method(proj4_class, "_axis_count", method_proj4_axis_count, 0);
   rb_define_module_function(proj4_class, "_proj_version", cmethod_proj4_version,
                             0);
+  rb_define_module_function(proj4_class, "_database_path",
+                            cmethod_proj4_database_path, 0);
+  rb_define_module_function(proj4_class, "_search_paths",
+                            cmethod_proj4_search_paths, 0);
+  rb_define_module_function(proj4_class, "_network_enabled",
+                            cmethod_proj4_network_enabled, 0);
 
   coordinate_transform_class =
       rb_define_class_under(cs_module, "CoordinateTransform", cs_info_class);
@@ -629,25 +3528,71 @@ static void rgeo_init_proj4() {
                                            coordinate_transform_class);
   rb_define_alloc_func(crs_to_crs_class, rgeo_crs_to_crs_data_alloc);
   rb_define_module_function(crs_to_crs_class, "_create",
-                            cmethod_crs_to_crs_create, 2);
+                            cmethod_crs_to_crs_create, 5);
+  rb_define_module_function(crs_to_crs_class, "_create_from_definition",
+                            cmethod_crs_to_crs_create_from_definition, 3);
   rb_define_method(crs_to_crs_class, "_transform_coords",
                    method_crs_to_crs_transform, 3);
+  rb_define_method(crs_to_crs_class, "_transform_buffer",
+                   method_crs_to_crs_transform_buffer, 6);
+  rb_define_method(crs_to_crs_class, "_transform_columns",
+                   method_crs_to_crs_transform_columns, 6);
+  rb_define_method(crs_to_crs_class, "_transform_bounds",
+                   method_crs_to_crs_transform_bounds, 5);
+  rb_define_method(crs_to_crs_class, "_transform_coordinates",
+                   method_crs_to_crs_transform_coordinates, 5);
+  rb_define_method(crs_to_crs_class, "_transform_wkb",
+                   method_crs_to_crs_transform_wkb, 4);
+  rb_define_method(crs_to_crs_class, "_inverse", method_crs_to_crs_inverse, 0);
+  rb_define_method(crs_to_crs_class, "_approximate",
+                   method_crs_to_crs_approximate, 2);
+  rb_define_method(crs_to_crs_class, "_definition",
+                   method_crs_to_crs_definition, 0);
   rb_define_method(crs_to_crs_class, "_as_text", method_crs_to_crs_wkt_str, 0);
   rb_define_method(crs_to_crs_class, "_proj_type", method_crs_to_crs_proj_type,
                    0);
   rb_define_method(crs_to_crs_class, "_area_of_use",
                    method_crs_to_crs_area_of_use_str, 0);
+  rb_define_method(crs_to_crs_class, "_operation", method_crs_to_crs_operation,
+                   0);
+  rb_define_method(crs_to_crs_class, "_fast_path", method_crs_to_crs_fast_path,
+                   0);
   rb_define_method(crs_to_crs_class, "_identity?", method_crs_to_crs_identity,
                    2);
+  rb_define_method(crs_to_crs_class, "_transform_buffer_async",
+                   method_crs_to_crs_transform_buffer_async, 6);
+  rb_define_method(crs_to_crs_class, "_transform_coordinates_async",
+                   method_crs_to_crs_transform_coordinates_async, 4);
+
+  rgeo_transform_future_class =
+      rb_define_class_under(coordsys_module, "TransformFuture", rb_cObject);
+  rb_undef_alloc_func(rgeo_transform_future_class);
+  rb_define_method(rgeo_transform_future_class, "_done?",
+                   method_transform_future_is_done, 0);
+  rb_define_method(rgeo_transform_future_class, "_value",
+                   method_transform_future_value, 0);
+
+  async_jobs = NULL;
+  async_registry = TypedData_Wrap_Struct(0, &rgeo_async_registry_type, NULL);
+  rb_gc_register_mark_object(async_registry);
 }
 
 #endif
 
 void Init_proj4_c_impl() {
 #ifdef RGEO_PROJ4_SUPPORTED
-  local_proj_context = proj_context_create();
+#ifdef HAVE_RB_EXT_RACTOR_SAFE
+  rb_ext_ractor_safe(true);
+#endif
+  rb_nativethread_lock_initialize(&export_lock);
+  rb_nativethread_lock_initialize(&proj4_lock);
+  rb_nativethread_lock_initialize(&async_lock);
+  rgeo_init_proj_context();
   rgeo_init_proj4();
   rgeo_init_proj_errors();
+  rgeo_init_proj_stats();
+  rgeo_init_proj_workers();
+  rgeo_init_proj_kernels();
 #endif
 }
 
@@ -0,0 +1,83 @@
+/*
+  Counters of the work done by PROJ
+*/
+
+#include <ruby.h>
+#include <ruby/atomic.h>
+
+#include "preface.h"
+
+#ifdef RGEO_PROJ4_SUPPORTED
+
+#include "stats.h"
+
+#ifdef HAVE_CLOCK_GETTIME
+#include <time.h>
+#endif
+
+RGEO_BEGIN_C
+
+static size_t stats[RGEO_STAT_COUNT];
+
+void rgeo_stats_add(RGeo_Stat stat, size_t value) {
+  RUBY_ATOMIC_SIZE_ADD(stats[stat], value);
+}
+
+size_t rgeo_stats_clock() {
+#ifdef HAVE_CLOCK_GETTIME
+  struct timespec ts;
+
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+    return (size_t)ts.tv_sec * 1000000000 + (size_t)ts.tv_nsec;
+  }
+#endif
+  return 0;
+}
+
+static VALUE rgeo_stats_seconds(size_t nanoseconds) {
+  return DBL2NUM(nanoseconds / 1e9);
+}
+
+static VALUE cmethod_coord_sys_native_stats(VALUE module) {
+  VALUE result;
+
+  result = rb_hash_new();
+  rb_hash_aset(result, ID2SYM(rb_intern("crs_created")),
+               SIZET2NUM(stats[RGEO_STAT_CRS_CREATED]));
+  rb_hash_aset(result, ID2SYM(rb_intern("crs_create_time")),
+               rgeo_stats_seconds(stats[RGEO_STAT_CRS_CREATE_TIME]));
+  rb_hash_aset(result, ID2SYM(rb_intern("pipelines_created")),
+               SIZET2NUM(stats[RGEO_STAT_PIPELINES_CREATED]));
+  rb_hash_aset(result, ID2SYM(rb_intern("pipeline_create_time")),
+               rgeo_stats_seconds(stats[RGEO_STAT_PIPELINE_CREATE_TIME]));
+  rb_hash_aset(result, ID2SYM(rb_intern("points_transformed")),
+               SIZET2NUM(stats[RGEO_STAT_POINTS_TRANSFORMED]));
+  rb_hash_aset(result, ID2SYM(rb_intern("proj_errors")),
+               SIZET2NUM(stats[RGEO_STAT_PROJ_ERRORS]));
+  return result;
+}
+
+static VALUE cmethod_coord_sys_reset_native_stats(VALUE module) {
+  int i;
+
+  for (i = 0; i < RGEO_STAT_COUNT; i++) {
+    RUBY_ATOMIC_SIZE_EXCHANGE(stats[i], 0);
+  }
+  return Qnil;
+}
+
+void rgeo_init_proj_stats() {
+  VALUE rgeo_module;
+  VALUE coordsys_module;
+
+  rgeo_module = rb_define_module("RGeo");
+  coordsys_module = rb_define_module_under(rgeo_module, "CoordSys");
+  rb_define_module_function(coordsys_module, "_native_stats",
+                            cmethod_coord_sys_native_stats, 0);
+  rb_define_module_function(coordsys_module, "_reset_native_stats",
+                            cmethod_coord_sys_reset_native_stats, 0);
+}
+
+RGEO_END_C
+
+#endif // RGEO_PROJ4_SUPPORTED
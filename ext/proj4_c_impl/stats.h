@@ -0,0 +1,35 @@
+#ifndef RGEO_PROJ4_STATS_INCLUDED
+#define RGEO_PROJ4_STATS_INCLUDED
+
+#include <ruby.h>
+
+#ifdef RGEO_PROJ4_SUPPORTED
+
+RGEO_BEGIN_C
+
+// Process-wide counters of the work done by PROJ, exposed to Ruby through
+// RGeo::CoordSys.stats. Durations are counted in nanoseconds.
+typedef enum {
+  RGEO_STAT_CRS_CREATED,
+  RGEO_STAT_CRS_CREATE_TIME,
+  RGEO_STAT_PIPELINES_CREATED,
+  RGEO_STAT_PIPELINE_CREATE_TIME,
+  RGEO_STAT_POINTS_TRANSFORMED,
+  RGEO_STAT_PROJ_ERRORS,
+  RGEO_STAT_COUNT
+} RGeo_Stat;
+
+// Adds value to a counter. Safe to call without the GVL.
+void rgeo_stats_add(RGeo_Stat stat, size_t value);
+
+// Returns a monotonic time in nanoseconds, used to time PROJ calls. Returns
+// 0 when no monotonic clock is available, so that durations stay at 0.
+size_t rgeo_stats_clock();
+
+void rgeo_init_proj_stats();
+
+RGEO_END_C
+
+#endif // RGEO_PROJ4_SUPPORTED
+
+#endif // RGEO_PROJ4_STATS_INCLUDED
@@ -0,0 +1,216 @@
+/*
+  Walker over the coordinates of WKB and EWKB geometries
+*/
+
+#include <ruby.h>
+
+#include "preface.h"
+
+#ifdef RGEO_PROJ4_SUPPORTED
+
+#include "wkb.h"
+#include <string.h>
+
+RGEO_BEGIN_C
+
+// Nesting limit of collections, so that hostile input cannot overflow the
+// stack.
+#define RGEO_WKB_MAX_DEPTH 32
+
+typedef struct {
+  unsigned char *bytes;
+  size_t size;
+  size_t offset;
+  RGeo_WKBVisitor visit;
+  void *arg;
+} RGeo_WKBWalk;
+
+static int rgeo_wkb_host_is_little_endian() {
+  const uint16_t one = 1;
+  return *(const unsigned char *)&one == 1;
+}
+
+static void rgeo_wkb_reverse(unsigned char *bytes, size_t size) {
+  unsigned char tmp;
+  size_t i;
+
+  for (i = 0; i < size / 2; i++) {
+    tmp = bytes[i];
+    bytes[i] = bytes[size - 1 - i];
+    bytes[size - 1 - i] = tmp;
+  }
+}
+
+uint32_t rgeo_wkb_get_uint32(const unsigned char *bytes, int swap) {
+  unsigned char copy[sizeof(uint32_t)];
+  uint32_t value;
+
+  memcpy(copy, bytes, sizeof(copy));
+  if (swap) {
+    rgeo_wkb_reverse(copy, sizeof(copy));
+  }
+  memcpy(&value, copy, sizeof(value));
+  return value;
+}
+
+void rgeo_wkb_put_uint32(unsigned char *bytes, uint32_t value, int swap) {
+  memcpy(bytes, &value, sizeof(value));
+  if (swap) {
+    rgeo_wkb_reverse(bytes, sizeof(value));
+  }
+}
+
+double rgeo_wkb_get_double(const unsigned char *bytes, int swap) {
+  unsigned char copy[sizeof(double)];
+  double value;
+
+  memcpy(copy, bytes, sizeof(copy));
+  if (swap) {
+    rgeo_wkb_reverse(copy, sizeof(copy));
+  }
+  memcpy(&value, copy, sizeof(value));
+  return value;
+}
+
+void rgeo_wkb_put_double(unsigned char *bytes, double value, int swap) {
+  memcpy(bytes, &value, sizeof(value));
+  if (swap) {
+    rgeo_wkb_reverse(bytes, sizeof(value));
+  }
+}
+
+const char *rgeo_wkb_read_header(const unsigned char *wkb, size_t size,
+                                 RGeo_WKBHeader *header) {
+  if (size < 5) {
+    return "truncated geometry header";
+  }
+  if (wkb[0] > 1) {
+    return "invalid byte order";
+  }
+  header->swap = (wkb[0] == 1) != rgeo_wkb_host_is_little_endian();
+  header->type = rgeo_wkb_get_uint32(wkb + 1, header->swap);
+  header->has_srid = (header->type & RGEO_EWKB_SRID_FLAG) != 0;
+  header->size = header->has_srid ? 9 : 5;
+  if (size < header->size) {
+    return "truncated geometry header";
+  }
+  return NULL;
+}
+
+static const char *rgeo_wkb_read_count(RGeo_WKBWalk *walk, int swap,
+                                       size_t *count) {
+  if (walk->size - walk->offset < 4) {
+    return "truncated geometry";
+  }
+  *count = rgeo_wkb_get_uint32(walk->bytes + walk->offset, swap);
+  walk->offset += 4;
+  return NULL;
+}
+
+static const char *rgeo_wkb_walk_coords(RGeo_WKBWalk *walk, size_t count,
+                                        int dimension, int has_z, int swap) {
+  size_t stride;
+
+  stride = dimension * sizeof(double);
+  if (count > (walk->size - walk->offset) / stride) {
+    return "truncated coordinates";
+  }
+  if (count > 0) {
+    walk->visit(walk->bytes + walk->offset, count, dimension, has_z, swap,
+                walk->arg);
+  }
+  walk->offset += count * stride;
+  return NULL;
+}
+
+static const char *rgeo_wkb_walk_geometry(RGeo_WKBWalk *walk, int depth) {
+  RGeo_WKBHeader header;
+  const char *error;
+  uint32_t type;
+  uint32_t base_type;
+  int has_z;
+  int has_m;
+  int dimension;
+  size_t count;
+  size_t rings;
+  size_t i;
+
+  if (depth > RGEO_WKB_MAX_DEPTH) {
+    return "geometry is nested too deeply";
+  }
+  error = rgeo_wkb_read_header(walk->bytes + walk->offset,
+                               walk->size - walk->offset, &header);
+  if (error) {
+    return error;
+  }
+  walk->offset += header.size;
+
+  // Z and M are given either by EWKB flags or by ISO type codes.
+  type = header.type & ~(RGEO_EWKB_Z_FLAG | RGEO_EWKB_M_FLAG |
+                         RGEO_EWKB_SRID_FLAG);
+  has_z = (header.type & RGEO_EWKB_Z_FLAG) != 0;
+  has_m = (header.type & RGEO_EWKB_M_FLAG) != 0;
+  if (type > 3000) {
+    has_z = has_m = 1;
+  } else if (type > 2000) {
+    has_m = 1;
+  } else if (type > 1000) {
+    has_z = 1;
+  }
+  base_type = type % 1000;
+  dimension = 2 + has_z + has_m;
+
+  switch (base_type) {
+  case 1: // Point
+    return rgeo_wkb_walk_coords(walk, 1, dimension, has_z, header.swap);
+  case 2: // LineString
+    error = rgeo_wkb_read_count(walk, header.swap, &count);
+    if (!error) {
+      error =
+          rgeo_wkb_walk_coords(walk, count, dimension, has_z, header.swap);
+    }
+    return error;
+  case 3: // Polygon
+    error = rgeo_wkb_read_count(walk, header.swap, &rings);
+    for (i = 0; !error && i < rings; i++) {
+      error = rgeo_wkb_read_count(walk, header.swap, &count);
+      if (!error) {
+        error =
+            rgeo_wkb_walk_coords(walk, count, dimension, has_z, header.swap);
+      }
+    }
+    return error;
+  case 4: // MultiPoint
+  case 5: // MultiLineString
+  case 6: // MultiPolygon
+  case 7: // GeometryCollection
+    error = rgeo_wkb_read_count(walk, header.swap, &count);
+    for (i = 0; !error && i < count; i++) {
+      error = rgeo_wkb_walk_geometry(walk, depth + 1);
+    }
+    return error;
+  default:
+    return "unsupported geometry type";
+  }
+}
+
+const char *rgeo_wkb_walk(unsigned char *wkb, size_t size,
+                          RGeo_WKBVisitor visit, void *arg) {
+  RGeo_WKBWalk walk;
+  const char *error;
+
+  walk.bytes = wkb;
+  walk.size = size;
+  walk.offset = 0;
+  walk.visit = visit;
+  walk.arg = arg;
+  error = rgeo_wkb_walk_geometry(&walk, 0);
+  if (!error && walk.offset != size) {
+    error = "trailing bytes after geometry";
+  }
+  return error;
+}
+
+RGEO_END_C
+
+#endif // RGEO_PROJ4_SUPPORTED
@@ -0,0 +1,58 @@
+#ifndef RGEO_PROJ4_WKB_INCLUDED
+#define RGEO_PROJ4_WKB_INCLUDED
+
+#include <ruby.h>
+
+#ifdef RGEO_PROJ4_SUPPORTED
+
+#include <stdint.h>
+
+RGEO_BEGIN_C
+
+// EWKB flags of the geometry type
+#define RGEO_EWKB_Z_FLAG 0x80000000u
+#define RGEO_EWKB_M_FLAG 0x40000000u
+#define RGEO_EWKB_SRID_FLAG 0x20000000u
+
+// Header of a WKB or EWKB geometry: byte order, geometry type and SRID.
+typedef struct {
+  // Set when the geometry is not in the byte order of this machine.
+  int swap;
+  // Type with its EWKB flags, as read from the bytes.
+  uint32_t type;
+  // Size of the header, including the SRID if has_srid is set.
+  size_t size;
+  int has_srid;
+} RGeo_WKBHeader;
+
+// Called for each sequence of coordinates of a geometry. coords points to
+// count unaligned coordinates of dimension doubles each, with Z at index 2
+// when has_z is set. They are stored byte swapped when swap is set.
+typedef void (*RGeo_WKBVisitor)(unsigned char *coords, size_t count,
+                                int dimension, int has_z, int swap, void *arg);
+
+// Reads the header of the geometry starting at wkb. Returns NULL, or a
+// message describing why the bytes are not valid WKB.
+const char *rgeo_wkb_read_header(const unsigned char *wkb, size_t size,
+                                 RGeo_WKBHeader *header);
+
+// Walks every coordinate sequence of the WKB or EWKB geometry held by the
+// size bytes at wkb, which must contain exactly one geometry. Returns NULL,
+// or a message describing why the bytes are not valid WKB, in which case
+// visit may have been called for some of the coordinates.
+const char *rgeo_wkb_walk(unsigned char *wkb, size_t size,
+                          RGeo_WKBVisitor visit, void *arg);
+
+uint32_t rgeo_wkb_get_uint32(const unsigned char *bytes, int swap);
+
+void rgeo_wkb_put_uint32(unsigned char *bytes, uint32_t value, int swap);
+
+double rgeo_wkb_get_double(const unsigned char *bytes, int swap);
+
+void rgeo_wkb_put_double(unsigned char *bytes, double value, int swap);
+
+RGEO_END_C
+
+#endif // RGEO_PROJ4_SUPPORTED
+
+#endif // RGEO_PROJ4_WKB_INCLUDED
@@ -0,0 +1,278 @@
+/*
+  Pool of native threads running batch transforms in parallel
+*/
+
+#include <ruby.h>
+
+#include "preface.h"
+
+#ifdef RGEO_PROJ4_SUPPORTED
+
+#include "workers.h"
+
+#ifdef HAVE_PTHREAD_CREATE
+#include <pthread.h>
+#include <stdlib.h>
+#endif
+
+RGEO_BEGIN_C
+
+static size_t workers_count = 1;
+
+size_t rgeo_workers_count() { return workers_count; }
+
+void rgeo_workers_set_count(size_t count) {
+  workers_count = count > 0 ? count : 1;
+}
+
+static VALUE cmethod_workers(VALUE klass) { return SIZET2NUM(workers_count); }
+
+static VALUE cmethod_set_workers(VALUE klass, VALUE count) {
+  long value;
+
+  value = NUM2LONG(count);
+  if (value < 1) {
+    rb_raise(rb_eArgError, "worker count must be at least 1, got %ld", value);
+  }
+  rgeo_workers_set_count((size_t)value);
+  return count;
+}
+
+static void rgeo_define_workers_methods() {
+  VALUE rgeo_module;
+  VALUE coordsys_module;
+  VALUE crs_to_crs_class;
+
+  rgeo_module = rb_define_module("RGeo");
+  coordsys_module = rb_define_module_under(rgeo_module, "CoordSys");
+  crs_to_crs_class = rb_const_get(coordsys_module, rb_intern("CRSToCRS"));
+  rb_define_module_function(crs_to_crs_class, "_workers", cmethod_workers, 0);
+  rb_define_module_function(crs_to_crs_class, "_set_workers",
+                            cmethod_set_workers, 1);
+}
+
+#ifdef HAVE_PTHREAD_CREATE
+
+// A batch of tasks. Jobs run with rgeo_workers_run live on the stack of the
+// calling thread, which waits for every task to be done before returning.
+// Submitted jobs are allocated and freed by the thread finishing them.
+typedef struct RGeo_WorkerJob {
+  RGeo_WorkerTask task;
+  RGeo_WorkerDone finish;
+  void *arg;
+  size_t count;
+  size_t next;
+  size_t done;
+  pthread_cond_t done_cond;
+  struct RGeo_WorkerJob *next_job;
+} RGeo_WorkerJob;
+
+static pthread_mutex_t jobs_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobs_cond = PTHREAD_COND_INITIALIZER;
+// Jobs that still have tasks to hand out.
+static RGeo_WorkerJob *jobs;
+// Worker threads started so far. They are never stopped, and idle ones
+// wait on jobs_cond.
+static size_t threads_started;
+
+// Takes the next task to run, or returns NULL when there is none. Must be
+// called with jobs_mutex held.
+static RGeo_WorkerJob *rgeo_workers_take(size_t *index) {
+  RGeo_WorkerJob *job;
+
+  job = jobs;
+  if (job) {
+    *index = job->next++;
+    if (job->next == job->count) {
+      jobs = job->next_job;
+    }
+  }
+  return job;
+}
+
+static void rgeo_workers_complete(RGeo_WorkerJob *job) {
+  RGeo_WorkerDone finish;
+  int last;
+
+  pthread_mutex_lock(&jobs_mutex);
+  finish = job->finish;
+  last = ++job->done == job->count;
+  if (last && !finish) {
+    pthread_cond_signal(&job->done_cond);
+  }
+  pthread_mutex_unlock(&jobs_mutex);
+
+  if (last && finish) {
+    finish(job->arg);
+    free(job);
+  }
+}
+
+static void *rgeo_workers_loop(void *unused) {
+  RGeo_WorkerJob *job;
+  size_t index;
+
+  for (;;) {
+    pthread_mutex_lock(&jobs_mutex);
+    while (!(job = rgeo_workers_take(&index))) {
+      pthread_cond_wait(&jobs_cond, &jobs_mutex);
+    }
+    pthread_mutex_unlock(&jobs_mutex);
+
+    job->task(job->arg, index);
+    rgeo_workers_complete(job);
+  }
+  return NULL;
+}
+
+// Starts worker threads until there are at least threads of them. Returns 0
+// if none could be started.
+static int rgeo_workers_start(size_t threads) {
+  pthread_t thread;
+  pthread_attr_t attr;
+  int started;
+
+  started = 1;
+  pthread_mutex_lock(&jobs_mutex);
+  if (threads_started < threads) {
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    while (threads_started < threads) {
+      if (pthread_create(&thread, &attr, rgeo_workers_loop, NULL) != 0) {
+        started = threads_started > 0;
+        break;
+      }
+      threads_started++;
+    }
+    pthread_attr_destroy(&attr);
+  }
+  pthread_mutex_unlock(&jobs_mutex);
+  return started;
+}
+
+int rgeo_workers_prepare() { return rgeo_workers_start(workers_count - 1); }
+
+// Appends job to the queue and wakes the idle workers. Must be called with
+// jobs_mutex held.
+static void rgeo_workers_enqueue(RGeo_WorkerJob *job) {
+  RGeo_WorkerJob **tail;
+
+  for (tail = &jobs; *tail; tail = &(*tail)->next_job) {
+  }
+  *tail = job;
+  pthread_cond_broadcast(&jobs_cond);
+}
+
+void rgeo_workers_run(RGeo_WorkerTask task, void *arg, size_t count) {
+  RGeo_WorkerJob job;
+  RGeo_WorkerJob **tail;
+  size_t index;
+
+  if (count == 0) {
+    return;
+  }
+  job.task = task;
+  job.finish = NULL;
+  job.arg = arg;
+  job.count = count;
+  job.next = 0;
+  job.done = 0;
+  job.next_job = NULL;
+  pthread_cond_init(&job.done_cond, NULL);
+
+  pthread_mutex_lock(&jobs_mutex);
+  rgeo_workers_enqueue(&job);
+
+  // The calling thread works on its own job until every task is handed out,
+  // then waits for the workers to finish theirs.
+  while (job.next < job.count) {
+    index = job.next++;
+    if (job.next == job.count) {
+      for (tail = &jobs; *tail != &job; tail = &(*tail)->next_job) {
+      }
+      *tail = job.next_job;
+    }
+    pthread_mutex_unlock(&jobs_mutex);
+    task(arg, index);
+    pthread_mutex_lock(&jobs_mutex);
+    job.done++;
+  }
+  while (job.done < job.count) {
+    pthread_cond_wait(&job.done_cond, &jobs_mutex);
+  }
+  pthread_mutex_unlock(&jobs_mutex);
+  pthread_cond_destroy(&job.done_cond);
+}
+
+int rgeo_workers_submit(RGeo_WorkerTask task, void *arg, size_t count,
+                        RGeo_WorkerDone finish) {
+  RGeo_WorkerJob *job;
+
+  // The caller does not take part, so at least one worker is needed even
+  // when CRSToCRS.workers is 1.
+  if (count == 0 ||
+      !rgeo_workers_start(workers_count > 1 ? workers_count - 1 : 1)) {
+    return 0;
+  }
+  // Allocated with malloc rather than ALLOC, as it is freed by a worker.
+  job = malloc(sizeof(RGeo_WorkerJob));
+  if (!job) {
+    return 0;
+  }
+  job->task = task;
+  job->finish = finish;
+  job->arg = arg;
+  job->count = count;
+  job->next = 0;
+  job->done = 0;
+  job->next_job = NULL;
+
+  pthread_mutex_lock(&jobs_mutex);
+  rgeo_workers_enqueue(job);
+  pthread_mutex_unlock(&jobs_mutex);
+  return 1;
+}
+
+#ifdef HAVE_PTHREAD_ATFORK
+// Worker threads do not survive a fork, the child starts new ones when
+// needed. A job being run by another thread of the parent is abandoned with
+// that thread.
+static void rgeo_workers_atfork_child(void) {
+  pthread_mutex_init(&jobs_mutex, NULL);
+  pthread_cond_init(&jobs_cond, NULL);
+  jobs = NULL;
+  threads_started = 0;
+}
+#endif
+
+void rgeo_init_proj_workers() {
+#ifdef HAVE_PTHREAD_ATFORK
+  pthread_atfork(NULL, NULL, rgeo_workers_atfork_child);
+#endif
+  rgeo_define_workers_methods();
+}
+
+#else
+
+int rgeo_workers_prepare() { return 0; }
+
+void rgeo_workers_run(RGeo_WorkerTask task, void *arg, size_t count) {
+  size_t i;
+
+  for (i = 0; i < count; i++) {
+    task(arg, i);
+  }
+}
+
+int rgeo_workers_submit(RGeo_WorkerTask task, void *arg, size_t count,
+                        RGeo_WorkerDone finish) {
+  return 0;
+}
+
+void rgeo_init_proj_workers() { rgeo_define_workers_methods(); }
+
+#endif // HAVE_PTHREAD_CREATE
+
+RGEO_END_C
+
+#endif // RGEO_PROJ4_SUPPORTED
@@ -0,0 +1,42 @@
+#ifndef RGEO_PROJ4_WORKERS_INCLUDED
+#define RGEO_PROJ4_WORKERS_INCLUDED
+
+#include <ruby.h>
+
+#ifdef RGEO_PROJ4_SUPPORTED
+
+RGEO_BEGIN_C
+
+typedef void (*RGeo_WorkerTask)(void *arg, size_t index);
+typedef void (*RGeo_WorkerDone)(void *arg);
+
+// Returns the number of threads, including the caller, that
+// rgeo_workers_run spreads tasks over.
+size_t rgeo_workers_count();
+
+void rgeo_workers_set_count(size_t count);
+
+// Starts the native threads needed by rgeo_workers_run. Must be called with
+// the GVL held. Returns 0 if they could not be started, in which case
+// rgeo_workers_run runs every task on the calling thread.
+int rgeo_workers_prepare();
+
+// Runs task(arg, i) for every i below count, on the calling thread and on
+// the native worker threads, and returns once all of them are done. Tasks
+// must not use the Ruby API, this is meant to be called without the GVL.
+void rgeo_workers_run(RGeo_WorkerTask task, void *arg, size_t count);
+
+// Queues task(arg, i) for every i below count on the native worker threads
+// and returns at once. finish(arg) is called, without the GVL, by the worker
+// completing the last task. Must be called with the GVL held. Returns 0,
+// without queuing anything, when no worker thread could be started.
+int rgeo_workers_submit(RGeo_WorkerTask task, void *arg, size_t count,
+                        RGeo_WorkerDone finish);
+
+void rgeo_init_proj_workers();
+
+RGEO_END_C
+
+#endif // RGEO_PROJ4_SUPPORTED
+
+#endif // RGEO_PROJ4_WORKERS_INCLUDED
@@ -0,0 +1,165 @@
+# frozen_string_literal: true
+
+module RGeo
+  module CoordSys
+    # Thread-safe cache of objects that are expensive to build.
+    #
+    # Lookups read a frozen Hash and take no lock. Building a missing value
+    # happens outside of the cache lock, at most once per key: other threads
+    # asking for the same key wait for that build, while lookups of other keys
+    # are not blocked. The cache is unbounded by default; when a capacity is
+    # set, the least recently used keys are evicted.
+    class Cache
+      # A cached value and the tick of its last lookup.
+      Entry = Struct.new(:value, :last_used)
+
+      # The lock serializing builds of one key, and the number of callers
+      # holding or waiting for it.
+      Flight = Struct.new(:mutex, :callers)
+
+      attr_reader :capacity
+
+      def initialize(capacity: nil)
+        check_capacity(capacity)
+        @entries = {}.freeze
+        @builds_in_flight = {}
+        @lock = Mutex.new
+        @capacity = capacity
+        @tick = 0
+        reset_counters
+      end
+
+      # Returns the value stored for key, building it with the given block
+      # if missing. Values are not stored when the block raises.
+      def fetch(key, &block)
+        entry = @entries[key]
+        return hit(entry) if entry
+
+        build(key, &block)
+      end
+
+      # Returns the value stored for key, or nil. Unlike fetch, this neither
+      # builds the value nor counts as a lookup.
+      def peek(key)
+        @entries[key]&.value
+      end
+
+      def size
+        @entries.size
+      end
+
+      # Sets the maximum number of stored keys, or nil for no limit.
+      def capacity=(capacity)
+        check_capacity(capacity)
+        @lock.synchronize do
+          @capacity = capacity
+          @entries = evict(@entries.dup).freeze
+        end
+      end
+
+      # Returns the lookup counters of the cache. Hits are counted without
+      # locking and may be slightly undercounted under contention.
+      #
+      # [<tt>:size</tt>] number of stored keys
+      # [<tt>:capacity</tt>] maximum number of stored keys, nil if unbounded
+      # [<tt>:hits</tt>] lookups served from the cache
+      # [<tt>:misses</tt>] lookups that had to wait for a build
+      # [<tt>:builds</tt>] values built and stored by the cache
+      # [<tt>:build_time</tt>] total seconds spent building them
+      # [<tt>:evictions</tt>] keys evicted to stay within capacity
+      def stats
+        {
+          size: @entries.size,
+          capacity: @capacity,
+          hits: @hits,
+          misses: @misses,
+          builds: @builds,
+          build_time: @build_time,
+          evictions: @evictions
+        }
+      end
+
+      def clear
+        @lock.synchronize do
+          @entries = {}.freeze
+          reset_counters
+        end
+      end
+
+      # Resets the counters returned by stats, keeping the stored values.
+      def reset_stats
+        @lock.synchronize { reset_counters }
+      end
+
+      private
+
+      def check_capacity(capacity)
+        raise ArgumentError, "capacity must be positive" if capacity && capacity < 1
+      end
+
+      def hit(entry)
+        @hits += 1
+        entry.last_used = (@tick += 1)
+        entry.value
+      end
+
+      def build(key)
+        flight = @lock.synchronize do
+          entry = @entries[key]
+          return hit(entry) if entry
+
+          @misses += 1
+          flight = (@builds_in_flight[key] ||= Flight.new(Mutex.new, 0))
+          flight.callers += 1
+          flight
+        end
+
+        begin
+          flight.mutex.synchronize do
+            entry = @entries[key]
+            return entry.value if entry
+
+            started = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+            value = yield
+            store(key, value, Process.clock_gettime(Process::CLOCK_MONOTONIC) - started)
+          end
+        ensure
+          # The flight is kept until its last caller leaves, so that a build
+          # that raised is retried by one caller at a time rather than by
+          # new callers in parallel with the waiting ones.
+          @lock.synchronize do
+            flight.callers -= 1
+            @builds_in_flight.delete(key) if flight.callers.zero?
+          end
+        end
+      end
+
+      def store(key, value, build_time)
+        @lock.synchronize do
+          entries = @entries.dup
+          entries[key] = Entry.new(value, @tick += 1)
+          @entries = evict(entries).freeze
+          @builds += 1
+          @build_time += build_time
+        end
+        value
+      end
+
+      def evict(entries)
+        while @capacity && entries.size > @capacity
+          entries.delete(entries.min_by { |_key, entry| entry.last_used }[0])
+          @evictions += 1
+        end
+        entries
+      end
+
+      def reset_counters
+        @hits = 0
+        @misses = 0
+        @builds = 0
+        @build_time = 0.0
+        @evictions = 0
+      end
+    end
+  end
+end
@@ -1,5 +1,6 @@
 # frozen_string_literal: true
 
+require "etc"
 require "singleton"
 module RGeo
   module CoordSys
@@ -9,17 +10,142 @@ module RGeo
     #
     # It also inherits from the RGeo::CoordSys::CoordinateTransform abstract class.
     class CRSToCRS < CS::CoordinateTransform
-      attr_accessor :source_cs, :target_cs
+      # Policies accepted by create, see there.
+      POLICIES = %i[best no_grids fastest].freeze
+
+      attr_accessor :source_cs, :target_cs, :operation_options
 
       class << self
-        def create(from, to)
-          crs_to_crs = _create(from, to)
+        # Creates the pipeline transforming coordinates from +from+ to +to+.
+        #
+        # By default PROJ keeps every candidate operation between the two
+        # CRSs and picks one for each transformed point. The following
+        # options narrow down the candidates:
+        #
+        # [<tt>:area</tt>]
+        #   Area of interest as <tt>[west, south, east, north]</tt> in
+        #   degrees. Only operations valid over that area are kept, so a
+        #   batch of coordinates inside it uses a single operation.
+        # [<tt>:accuracy</tt>]
+        #   Minimum accuracy, in meters, of the candidate operations.
+        # [<tt>:allow_ballpark</tt>]
+        #   Set to false to exclude ballpark transformations.
+        # [<tt>:only_best</tt>]
+        #   Set to true to fail instead of falling back to a less accurate
+        #   operation when the best one cannot be used. Requires PROJ 9.2.
+        # [<tt>:policy</tt>]
+        #   Trade-off between accuracy and speed, default_policy by
+        #   default:
+        #   [<tt>:best</tt>]
+        #     keep the candidates described above, PROJ using the most
+        #     accurate one available for each coordinate, which may
+        #     interpolate in grid files.
+        #   [<tt>:no_grids</tt>]
+        #     use the single most accurate operation needing no grid file,
+        #     typically a Helmert transformation accurate to a few meters.
+        #   [<tt>:fastest</tt>]
+        #     use a ballpark transformation, ignoring datum differences
+        #     (errors of up to a few hundred meters), when PROJ offers one
+        #     and the operation picked by <tt>:no_grids</tt> otherwise.
+        #   The <tt>:accuracy</tt> and <tt>:allow_ballpark</tt> options
+        #   still narrow down the candidates of the last two policies.
+        #   The operation picked is described by #operation.
+        #
+        # When a pipeline_cache is set, the resolved pipeline is read from
+        # or written to it.
+        def create(from, to, area: nil, accuracy: nil, allow_ballpark: nil, only_best: nil, policy: nil)
+          policy ||= default_policy
+          raise ArgumentError, "unknown policy #{policy.inspect}" unless POLICIES.include?(policy)
+
+          options = pipeline_options(accuracy, allow_ballpark, only_best)
+          crs_to_crs = create_pipeline(from, to, area&.map(&:to_f), options.empty? ? nil : options, policy)
           crs_to_crs.source_cs = from
           crs_to_crs.target_cs = to
+          crs_to_crs.operation_options = {
+            area: area, accuracy: accuracy, allow_ballpark: allow_ballpark, only_best: only_best,
+            policy: (policy unless policy == :best)
+          }.compact.freeze
+          crs_to_crs
+        end
+
+        # Policy used by create when none is given, <tt>:best</tt> unless
+        # set otherwise. Only used from the main Ractor, others always
+        # default to <tt>:best</tt>.
+        def default_policy
+          Ractor.current == Ractor.main ? @default_policy : :best
+        end
+
+        def default_policy=(policy)
+          raise ArgumentError, "unknown policy #{policy.inspect}" unless POLICIES.include?(policy)
+
+          @default_policy = policy
+        end
+
+        # Number of threads, including the calling one, sharing a parallel
+        # #transform_buffer. Defaults to the number of processors.
+        def workers
+          _workers
+        end
+
+        def workers=(count)
+          _set_workers(Integer(count))
+        end
+
+        # Whether create replaces the pipelines between well-known CRSs
+        # with closed-form kernels (see #fast_path), true by default. Set
+        # to false to always run PROJ.
+        def fast_paths
+          _fast_paths
+        end
+
+        def fast_paths=(enabled)
+          _set_fast_paths(enabled)
+        end
+
+        # On-disk PipelineCache used by create, nil (the default) to
+        # resolve every pipeline with PROJ. Only used from the main Ractor.
+        attr_reader :pipeline_cache
+
+        # Sets the directory of the on-disk PipelineCache, or nil to
+        # disable it.
+        def pipeline_cache=(path)
+          @pipeline_cache = path.nil? || path.is_a?(PipelineCache) ? path : PipelineCache.new(path)
+        end
+
+        private
+
+        def create_pipeline(from, to, area, options, policy)
+          cache = pipeline_cache if Ractor.current == Ractor.main
+          return _create(from, to, area, options, policy) unless cache
+
+          key = cache.key(from, to, area, options, policy)
+          definition = cache.read(key)
+          if definition
+            begin
+              return _create_from_definition(definition, from, to)
+            rescue Error::InvalidProjection
+              # Damaged entry, it is replaced below.
+            end
+          end
+
+          crs_to_crs = _create(from, to, area, options, policy)
+          definition = crs_to_crs._definition
+          cache.write(key, definition) if definition
           crs_to_crs
         end
+
+        def pipeline_options(accuracy, allow_ballpark, only_best)
+          options = []
+          options << "ACCURACY=#{Float(accuracy)}" unless accuracy.nil?
+          options << "ALLOW_BALLPARK=#{allow_ballpark ? 'YES' : 'NO'}" unless allow_ballpark.nil?
+          options << "ONLY_BEST=#{only_best ? 'YES' : 'NO'}" unless only_best.nil?
+          options
+        end
       end
 
+      self.workers = Etc.nprocessors
+      self.default_policy = :best
+
       alias from source_cs
       alias to target_cs
       alias to_wkt _as_text
@@ -37,44 +163,271 @@ module RGeo
         _area_of_use
       end
 
+      # Returns the policy the pipeline was created with, see create.
+      def policy
+        operation_options.fetch(:policy, :best)
+      end
+
+      # Describes the operation run by the pipeline, as picked by its
+      # policy:
+      #
+      # [<tt>:name</tt>] name of the operation
+      # [<tt>:accuracy</tt>] accuracy in meters
+      # [<tt>:grids</tt>] number of grid files it interpolates in
+      # [<tt>:ballpark</tt>] whether it ignores datum differences
+      #
+      # The name and accuracy are nil when unknown, and the whole
+      # description is meaningless when PROJ kept several candidate
+      # operations (see create).
+      def operation
+        name, accuracy, grids, ballpark = _operation
+        { name: name, accuracy: accuracy, grids: grids, ballpark: ballpark }
+      end
+
       def identity?
         _identity?(source_cs, target_cs)
       end
 
+      # Returns the kernel run instead of PROJ, picked when the pipeline is
+      # created between well-known CRSs, or nil:
+      #
+      # [<tt>:identity</tt>]
+      #   source and target are equivalent (see #identity?) and in the same
+      #   units, batch transforms only copy the coordinates.
+      # [<tt>:web_mercator</tt>]
+      #   between WGS 84 (EPSG:4326) and Web Mercator (EPSG:3857).
+      # [<tt>:utm</tt>]
+      #   between WGS 84 and one of its UTM zones (EPSG:32601 to 32660 and
+      #   EPSG:32701 to 32760).
+      #
+      # The kernels compute the same formulas as PROJ without its generic
+      # per-coordinate machinery. A kernel is only picked after agreeing
+      # with PROJ on sample points, within a micrometer in projected
+      # coordinates and 1e-11 degrees in geographic ones. Coordinates
+      # outside of the domain of a kernel (such as Web Mercator latitudes
+      # near the poles) are still transformed by PROJ.
+      def fast_path
+        _fast_path
+      end
+
+      # Returns a CRSToCRS transforming from target_cs to source_cs.
+      #
+      # When this pipeline is invertible, the inverse runs it in reverse
+      # without searching for a new operation, and shares it with this
+      # object (so its WKT is the one of this object). Otherwise a new
+      # pipeline is created.
+      def inverse
+        inverse = _inverse
+        return self.class.create(target_cs, source_cs, **operation_options) unless inverse
+
+        inverse.source_cs = target_cs
+        inverse.target_cs = source_cs
+        inverse.operation_options = operation_options
+        inverse
+      end
+
+      # Returns a CRSToCRS running this pipeline by interpolation over
+      # +bounds+, <tt>[xmin, ymin, xmax, ymax]</tt> in source coordinates,
+      # which is much faster for batch and geometry transforms over an area
+      # known in advance.
+      #
+      # The bounds are covered by a grid of cells, each split in halves
+      # until interpolating between the exact results at its corners is
+      # within +max_error+, in target units, of the exact results at test
+      # points inside the cell. Cells still off after 32 splits or 65536
+      # cells, and points outside the bounds, are transformed exactly, as
+      # are coordinates with a z. Building the grid transforms a few
+      # points per cell, so it pays off over large batches.
+      #
+      # The bound is checked at the test points only: it holds for smooth
+      # transforms, not across discontinuities (an antimeridian or a grid
+      # file boundary) smaller than a cell. The inverse of the result is
+      # exact.
+      def approximate(bounds, max_error:)
+        bounds = bounds.map(&:to_f).freeze
+        max_error = max_error.to_f
+        result = _approximate(bounds, max_error)
+        raise Error::InvalidProjection, "no pipeline to approximate" unless result
+
+        result.source_cs = source_cs
+        result.target_cs = target_cs
+        result.operation_options = operation_options
+        result.approximation = { bounds: bounds, max_error: max_error }.freeze
+        result
+      end
+
+      # Returns the bounds and maximum error of a CRSToCRS created by
+      # approximate, or nil for an exact one.
+      attr_reader :approximation
+
+      attr_writer :approximation # :nodoc:
+      protected :approximation=
+
       # transform the coordinates from the initial CRS to the destination CRS
+      #
+      # Geographic coordinates are in radians for a CRS created with the
+      # <tt>:radians</tt> option. That is resolved when the pipeline is
+      # created, for this method and the batch ones alike.
       def transform_coords(x, y, z)
-        if from._radians? && from._geographic?
-          x *= ImplHelper::Math::DEGREES_PER_RADIAN
-          y *= ImplHelper::Math::DEGREES_PER_RADIAN
-        end
-        result = _transform_coords(x, y, z)
-        if result && to._radians? && to._geographic?
-          result[0] *= ImplHelper::Math::RADIANS_PER_DEGREE
-          result[1] *= ImplHelper::Math::RADIANS_PER_DEGREE
+        _transform_coords(x, y, z)
+      end
+
+      # Transforms a packed buffer of coordinates in one call.
+      #
+      # The buffer is a binary String or an IO::Buffer holding interleaved
+      # native-endian doubles, +dimension+ (2 or 3) values per coordinate,
+      # as produced by <tt>coords.flatten.pack("d*")</tt>. Coordinates are
+      # transformed in place unless an +out+ buffer at least as large as
+      # the input is given. Returns the buffer holding the results.
+      #
+      # With <tt>parallel: true</tt>, large buffers are split between
+      # CRSToCRS.workers native threads, each one running its own copy of
+      # the pipeline. Results are identical to a serial transformation.
+      #
+      # Coordinates PROJ fails to transform are handled according to
+      # +on_error+:
+      #
+      # [<tt>:keep</tt>]
+      #   (default) leave them set to infinity, as returned by PROJ.
+      # [<tt>:nan</tt>]
+      #   set them to NaN.
+      # [<tt>:raise</tt>]
+      #   stop at the first one and raise Error::TransformError, leaving
+      #   the buffer partly transformed.
+      #
+      # Pass a TransformStatus as +status+ to get the number of failures
+      # and a bitmap of the transformed coordinates, without scanning
+      # the results. With <tt>on_error: :raise</tt>, it is filled in
+      # before the error is raised.
+      def transform_buffer(buffer, dimension = 2, out: nil, parallel: false, on_error: :keep, status: nil)
+        _transform_buffer(buffer, out, dimension, parallel, on_error, status)
+        out || buffer
+      end
+
+      # Transforms coordinates held in separate x, y and optional z
+      # columns, as used by columnar formats (Arrow, Parquet) and numeric
+      # arrays.
+      #
+      # Each column is a binary String or an IO::Buffer of native-endian
+      # doubles, one value every +stride+ bytes (8 by default, for packed
+      # doubles). Columns must hold the same number of values. They are
+      # transformed in place, unless +out+ gives as many output columns,
+      # which receive the results with the same stride. Returns the
+      # columns holding the results. See #transform_buffer for
+      # +parallel+, +on_error+ and +status+.
+      def transform_columns(x, y, z = nil, stride: nil, out: nil, parallel: false, on_error: :keep, status: nil)
+        columns = [x, y, z].compact
+        _transform_columns(columns, out, stride || 8, parallel, on_error, status)
+        out || columns
+      end
+
+      # Transforms float64 columns exported through the Arrow C Data
+      # Interface, without copying them or depending on an Arrow library.
+      #
+      # Each column is an <tt>[array, schema]</tt> pair of the addresses
+      # (Integers) of the <tt>ArrowArray</tt> and <tt>ArrowSchema</tt>
+      # structures describing it, as exported by the Arrow library in use.
+      # Columns are transformed in place, in the memory of their
+      # producer, unless +out+ gives output columns as accepted by
+      # #transform_columns. The arrays must stay alive, and not be
+      # released, during the call. Null slots are transformed like others.
+      # See #transform_buffer for +parallel+, +on_error+ and +status+.
+      def transform_arrow(x, y, z = nil, out: nil, parallel: false, on_error: :keep, status: nil)
+        columns = [x, y, z].compact
+        _transform_columns(columns, out, 8, parallel, on_error, status)
+        out || columns
+      end
+
+      # Transforms the bounding box (+xmin+, +ymin+, +xmax+, +ymax+) and
+      # returns the <tt>[xmin, ymin, xmax, ymax]</tt> envelope of the
+      # result.
+      #
+      # Transforming the corners alone misses the parts of the result that
+      # bulge out of them, so +densify_pts+ points are transformed along
+      # each edge as well. With PROJ 8.2 or later, the envelope accounts
+      # for poles inside the box, and a geographic result crossing the
+      # antimeridian is returned with xmin greater than xmax. Raises
+      # RGeo::Error::TransformError when the box cannot be transformed.
+      def transform_bounds(xmin, ymin, xmax, ymax, densify_pts: 21)
+        bounds = [xmin, ymin, xmax, ymax].pack("d4")
+        _transform_bounds(bounds, nil, densify_pts, :raise, nil)
+        bounds.unpack("d4")
+      end
+
+      # Transforms many bounding boxes at once, as #transform_bounds does.
+      #
+      # +buffer+ is a binary String or an IO::Buffer of native-endian
+      # doubles, each box packed as xmin, ymin, xmax and ymax. Boxes are
+      # transformed in place, unless +out+ gives a buffer at least as
+      # large to receive the results. Returns the buffer holding the
+      # results. See #transform_buffer for +on_error+ and +status+, which
+      # apply to whole boxes: the four values of a failed box are set to
+      # infinity or NaN.
+      def transform_bounds_buffer(buffer, densify_pts: 21, out: nil, on_error: :keep, status: nil)
+        _transform_bounds(buffer, out, densify_pts, on_error, status)
+        out || buffer
+      end
+
+      # Transforms a WKB geometry without building Ruby geometries.
+      #
+      # The coordinates are read from the binary String +wkb+ (ISO WKB
+      # or EWKB, in either byte order), transformed in bulk, and written
+      # to a new binary String with the same layout. M values are kept.
+      # Hex-encoded WKB must be decoded first, with <tt>[hex].pack("H*")</tt>.
+      # See #transform_buffer for +on_error+ and +status+, which count
+      # coordinates in the order they appear in the WKB.
+      def transform_wkb(wkb, on_error: :keep, status: nil)
+        _transform_wkb(wkb, false, on_error, status)
+      end
+
+      # Same as transform_wkb, but also sets the SRID of the resulting EWKB.
+      # It defaults to the authority code of the target CRS; when nil, the
+      # SRID is removed.
+      def transform_ewkb(ewkb, srid = target_cs.authority_code, on_error: :keep, status: nil)
+        _transform_wkb(ewkb, srid, on_error, status)
+      end
+
+      # Transforms the geometry into a new geometry built by to_factory.
+      #
+      # All the coordinates, including those of the members of a
+      # GeometryCollection, are transformed with a single native call, and
+      # the resulting points are handed to to_factory ring by ring. See
+      # #transform_buffer for +on_error+ and +status+, which count
+      # coordinates in the order of Geometry#coordinates.
+      def transform(from_geometry, to_factory, on_error: :keep, status: nil)
+        points = _transform_coordinates(geometry_coordinates(from_geometry), from_geometry.factory, to_factory,
+                                        on_error, status)
+        build_geometry(from_geometry, points, to_factory)
+      end
+
+      # Starts transforming a packed buffer of coordinates on the native
+      # worker threads, and returns a TransformFuture at once instead of
+      # blocking the calling thread or fiber.
+      #
+      # Takes the arguments of #transform_buffer, large buffers being
+      # split between the CRSToCRS.workers threads. The coordinates are
+      # copied when the call is made. The results are written to +out+
+      # (or +buffer+), and +status+ is filled in, by
+      # TransformFuture#value, which returns the buffer holding them.
+      # Without proj_clone (older PROJ versions), the pipeline cannot be
+      # handed to the workers and the transformation runs before this
+      # method returns.
+      def transform_buffer_async(buffer, dimension = 2, out: nil, on_error: :keep, status: nil)
+        finish = ->(result) { result }
+        async(finish) do |writer|
+          _transform_buffer_async(buffer, out, dimension, on_error, status, writer)
         end
-        result
       end
 
-      def transform(from_geometry, to_factory)
-        case from_geometry
-        when Feature::Point
-          transform_point(from_geometry, to_factory)
-        when Feature::Line
-          to_factory.line(from_geometry.points.map { |p| transform_point(p, to_factory) })
-        when Feature::LinearRing
-          transform_linear_ring(from_geometry, to_factory)
-        when Feature::LineString
-          to_factory.line_string(from_geometry.points.map { |p_| transform_point(p_, to_factory) })
-        when Feature::Polygon
-          transform_polygon(from_geometry, to_factory)
-        when Feature::MultiPoint
-          to_factory.multi_point(from_geometry.map { |p| transform_point(p, to_factory) })
-        when Feature::MultiLineString
-          to_factory.multi_line_string(from_geometry.map { |g| transform(g, to_factory) })
-        when Feature::MultiPolygon
-          to_factory.multi_polygon(from_geometry.map { |p| transform_polygon(p, to_factory) })
-        when Feature::GeometryCollection
-          to_factory.collection(from_geometry.map { |g| transform(g, to_factory) })
+      # Starts transforming the geometry on the native worker threads, as
+      # #transform_buffer_async does, and returns a TransformFuture whose
+      # value is the geometry built by to_factory. All the coordinates,
+      # including those of the members of a GeometryCollection, are
+      # transformed as one batch.
+      def transform_async(from_geometry, to_factory)
+        finish = ->(points) { build_geometry(from_geometry, points, to_factory) }
+        async(finish) do |writer|
+          _transform_coordinates_async(geometry_coordinates(from_geometry), from_geometry.factory, to_factory, writer)
         end
       end
 
@@ -88,48 +441,154 @@ module RGeo
         return unless coords_
         extras_ = []
         extras_ << coords_[2].to_f if to_has_z_
-        if to_has_m_
-          extras_ << from_has_m_ ? from_point.m : 0.0
-        end
+        extras_ << (from_has_m_ ? from_point.m : 0.0) if to_has_m_
         to_factory.point(coords_[0], coords_[1], *extras_)
       end
 
       def transform_linear_ring(from_ring_, to_factory_)
-        to_factory_.linear_ring(from_ring_.points[0..-2].map { |p_| transform_point(p_, to_factory_) })
+        to_factory_.linear_ring(transform_coordinates(from_ring_, to_factory_)[0..-2])
       end
 
       def transform_polygon(from_polygon_, to_factory_)
-        ext_ = transform_linear_ring(from_polygon_.exterior_ring, to_factory_)
-        int_ = from_polygon_.interior_rings.map { |r_| transform_linear_ring(r_, to_factory_) }
-        to_factory_.polygon(ext_, int_)
+        build_polygon(transform_coordinates(from_polygon_, to_factory_), to_factory_)
       end
 
       def inspect
         "#<#{self.class}:0x#{object_id.to_s(16)} @source_cs=#{source_cs.original_str} @target_cs=#{target_cs.original_str}>"
       end
+
+      private
+
+      # Transforms every coordinate of the geometry in one native call.
+      # Returns the nested arrays of Geometry#coordinates with each
+      # coordinate replaced by a point of to_factory.
+      def transform_coordinates(from_geometry, to_factory)
+        _transform_coordinates(from_geometry.coordinates, from_geometry.factory, to_factory, :keep, nil)
+      end
+
+      # Builds the geometry of to_factory matching from_geometry from the
+      # points replacing its coordinates.
+      def build_geometry(from_geometry, points, to_factory)
+        case from_geometry
+        when Feature::Point
+          points
+        when Feature::Line
+          to_factory.line(*points)
+        when Feature::LinearRing
+          to_factory.linear_ring(points[0..-2])
+        when Feature::LineString
+          to_factory.line_string(points)
+        when Feature::Polygon
+          build_polygon(points, to_factory)
+        when Feature::MultiPoint
+          to_factory.multi_point(points)
+        when Feature::MultiLineString
+          to_factory.multi_line_string(points.map { |line| to_factory.line_string(line) })
+        when Feature::MultiPolygon
+          to_factory.multi_polygon(points.map { |rings| build_polygon(rings, to_factory) })
+        when Feature::GeometryCollection
+          to_factory.collection(from_geometry.each_with_index.map { |g, i| build_geometry(g, points[i], to_factory) })
+        end
+      end
+
+      # Geometry#coordinates, extended to GeometryCollection members.
+      def geometry_coordinates(geometry)
+        case geometry
+        when Feature::GeometryCollection
+          geometry.map { |g| geometry_coordinates(g) }
+        else
+          geometry.coordinates
+        end
+      end
+
+      # Creates the completion pipe of a TransformFuture, yielding its
+      # write end to the native call starting the job. finish turns the
+      # native result into the value of the future.
+      def async(finish)
+        reader, writer = IO.pipe
+        begin
+          future = yield writer
+        ensure
+          writer.close
+          reader.close unless future
+        end
+        future.attach(reader, finish)
+      end
+
+      def build_polygon(rings, to_factory)
+        rings = rings.map { |points| to_factory.linear_ring(points[0..-2]) }
+        to_factory.polygon(rings.shift || to_factory.linear_ring([]), rings)
+      end
     end
 
     # Store of all the created CRSToCRS
+    #
+    # Lookups take no lock and each pair is built once, see Cache. The store is
+    # unbounded by default, set a capacity to evict the least recently used
+    # pairs.
     class CRSStore
       include Singleton
       class << self
-        def get(from, to)
-          instance.get(from, to)
+        def get(from, to, **options)
+          instance.get(from, to, **options)
+        end
+
+        def capacity
+          instance.capacity
+        end
+
+        def capacity=(capacity)
+          instance.capacity = capacity
+        end
+
+        def stats
+          instance.stats
+        end
+
+        def clear
+          instance.clear
         end
       end
 
-      Key = Struct.new(:from, :to)
+      Key = Struct.new(:from, :to, :options)
 
       def initialize
-        @store = Hash.new { |h, k| h[k] = CRSToCRS.create(k.from, k.to) }
-        @semaphore = Mutex.new
+        @cache = Cache.new
       end
 
-      def get(from, to)
-        @semaphore.synchronize do
-          @store[Key.new(from, to)]
+      # Returns the CRSToCRS from +from+ to +to+, created with the given
+      # options (see CRSToCRS.create). Pipelines are stored per pair and
+      # options. When the reverse pair is already stored with the same
+      # options, its pipeline is reused if invertible.
+      def get(from, to, **options)
+        options = { policy: CRSToCRS.default_policy }.merge(options).compact.freeze
+        @cache.fetch(Key.new(from, to, options)) do
+          reverse = @cache.peek(Key.new(to, from, options))
+          reverse ? reverse.inverse : CRSToCRS.create(from, to, **options)
         end
       end
+
+      def capacity
+        @cache.capacity
+      end
+
+      # Sets the maximum number of stored pairs, or nil for no limit.
+      def capacity=(capacity)
+        @cache.capacity = capacity
+      end
+
+      # Returns the lookup counters of the store, see Cache#stats.
+      def stats
+        @cache.stats
+      end
+
+      def reset_stats
+        @cache.reset_stats
+      end
+
+      def clear
+        @cache.clear
+      end
     end
   end
 end
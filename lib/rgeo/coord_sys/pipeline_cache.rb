@@ -0,0 +1,96 @@
+# frozen_string_literal: true
+
+require "digest"
+require "fileutils"
+
+module RGeo
+  module CoordSys
+    # On-disk cache of the pipelines resolved by CRSToCRS.create, enabled
+    # with <tt>CRSToCRS.pipeline_cache = path</tt>.
+    #
+    # Finding the operation between two coordinate systems means searching
+    # proj.db, which can take tens of milliseconds for some datum pairs.
+    # The cache stores the definition of the resolved pipeline, one file
+    # per source, target and options, so that other processes instantiate
+    # it directly. Entries are keyed on the PROJ version and a checksum of
+    # proj.db as well, so upgrading either one starts a fresh set of
+    # entries. The operation PROJ resolves also depends on the grid files
+    # it finds, so the key includes the directories it searches, when they
+    # last changed, and whether it may download grids.
+    #
+    # Only pipelines made of a single operation can be stored. When PROJ
+    # keeps several candidate operations (no area of interest given, and
+    # no operation valid everywhere), the pipeline is resolved every time,
+    # so that PROJ itself picks the operation for each coordinate.
+    class PipelineCache
+      attr_reader :path
+
+      def initialize(path)
+        @path = path.to_s
+      end
+
+      # Returns the key of the pipeline between the Proj4 objects +from+
+      # and +to+, with the area, options and policy passed to
+      # CRSToCRS._create.
+      def key(from, to, area, options, policy = :best)
+        Digest::SHA256.hexdigest(
+          [environment, from.as_text, to.as_text, area.inspect, options.inspect, policy.inspect].join("\n")
+        )
+      end
+
+      # Returns the definition stored under +key+, or nil.
+      def read(key)
+        File.read(entry_path(key), encoding: Encoding::UTF_8)
+      rescue SystemCallError
+        nil
+      end
+
+      # Stores +definition+ under +key+. The entry is written to a
+      # temporary file then renamed, so that concurrent readers never see
+      # a partial entry. Failing to write, on a read-only or full disk,
+      # only leaves the entry out.
+      def write(key, definition)
+        file = entry_path(key)
+        tmp = "#{file}.#{Process.pid}.#{Thread.current.object_id}.tmp"
+        FileUtils.mkdir_p(@path)
+        File.binwrite(tmp, definition)
+        File.rename(tmp, file)
+      rescue SystemCallError
+        nil
+      ensure
+        FileUtils.rm_f(tmp) if tmp
+      end
+
+      # Removes every entry.
+      def clear
+        FileUtils.rm_f(Dir.glob(File.join(@path, "*.json")))
+      end
+
+      private
+
+      def entry_path(key)
+        File.join(@path, "#{key}.json")
+      end
+
+      # Computed once per process, as it reads the whole of proj.db.
+      def environment
+        @environment ||= [Proj4.version, database_checksum, *grid_directories, Proj4._network_enabled].join(" ")
+      end
+
+      # Directories searched for grid files, with the time each one last
+      # changed, which installing or removing a grid updates.
+      def grid_directories
+        Proj4._search_paths.map do |dir|
+          "#{dir}@#{File.mtime(dir).to_i}"
+        rescue SystemCallError
+          dir
+        end
+      end
+
+      def database_checksum
+        database = Proj4._database_path
+        database && File.file?(database) ? Digest::SHA256.file(database).hexdigest : ""
+      end
+    end
+  end
+end
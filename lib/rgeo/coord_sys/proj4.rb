@@ -20,7 +20,19 @@ module RGeo
     # coordinate transformations.
 
     class Proj4 < CS::CoordinateSystem
-      attr_accessor :dimension
+      # Default number of definitions kept by Proj4.cache.
+      DEFINITION_CACHE_CAPACITY = 256
+
+      @cache = Cache.new(capacity: DEFINITION_CACHE_CAPACITY)
+
+      attr_writer :dimension
+
+      # Returns the number of axes of the coordinate system, unless set
+      # otherwise with dimension=.
+
+      def dimension
+        @dimension || _axis_count
+      end
 
       def inspect # :nodoc:
         "#<#{self.class}:0x#{object_id.to_s(16)} #{canonical_str.inspect}>"
@@ -31,31 +43,34 @@ module RGeo
       end
 
       def hash  # :nodoc:
-        @hash ||= canonical_hash.hash
+        _fingerprint
       end
 
       # Returns true if this Proj4 is equivalent to the given Proj4.
       #
-      # Note: this tests for equivalence by comparing only the hash
-      # definitions of the Proj4 objects, and returning true if those
-      # definitions are equivalent. In some cases, this may still return
-      # false even if the actual coordinate systems are identical, since
-      # there are sometimes multiple ways to express a given coordinate
-      # system.
+      # Note: this tests for equivalence by comparing the canonical
+      # definitions of the Proj4 objects, as reported by Proj4. In some
+      # cases, this may still return false even if the actual coordinate
+      # systems are identical, since there are sometimes multiple ways to
+      # express a given coordinate system.
 
       def eql?(other)
-        other.class == self.class && other.canonical_hash == canonical_hash && other._radians? == _radians?
+        other.class == self.class && _eql?(other)
       end
       alias == eql?
 
       # Marshal support
+      #
+      # Loaded objects are copies of the Proj4 returned by create for their
+      # definition, sharing its native PJ. Proj4.cache interns them, so
+      # that loading a definition seen before does not parse it again.
 
       def marshal_dump # :nodoc:
         { "rad" => radians?, "str" => original_str || canonical_str }
       end
 
       def marshal_load(data_) # :nodoc:
-        _set_value(data_["str"], data_["rad"])
+        initialize_copy(self.class.create(data_["str"], radians: data_["rad"]))
       end
 
       # Psych support
@@ -67,9 +82,9 @@ module RGeo
 
       def init_with(coder_) # :nodoc:
         if coder_.type == :scalar
-          _set_value(coder_.scalar, false)
+          initialize_copy(self.class.create(coder_.scalar))
         else
-          _set_value(coder_["proj4"], coder_["radians"])
+          initialize_copy(self.class.create(coder_["proj4"], radians: coder_["radians"]))
         end
       end
 
@@ -78,11 +93,7 @@ module RGeo
       # from the definition used to construct this object.
 
       def canonical_str
-        unless defined?(@canonical_str)
-          @canonical_str = _canonical_str
-          @canonical_str.force_encoding("US-ASCII") if @canonical_str.respond_to?(:force_encoding)
-        end
-        @canonical_str
+        _canonical_str
       end
 
       # Returns the "canonical" hash definition for this coordinate
@@ -90,13 +101,14 @@ module RGeo
       # from the definition used to construct this object.
 
       def canonical_hash
-        unless defined?(@canonical_hash)
-          @canonical_hash = {}
-          canonical_str.strip.split(/\s+/).each do |elem_|
-            @canonical_hash[Regexp.last_match(1)] = Regexp.last_match(3) if elem_ =~ /^\+(\w+)(=(\S+))?$/
-          end
+        return @canonical_hash if defined?(@canonical_hash)
+
+        result_ = {}
+        canonical_str.strip.split(/\s+/).each do |elem_|
+          result_[Regexp.last_match(1)] = Regexp.last_match(3) if elem_ =~ /^\+(\w+)(=(\S+))?$/
         end
-        @canonical_hash
+        @canonical_hash = result_ unless frozen?
+        result_
       end
 
       # Returns the string definition originally used to construct this
@@ -126,13 +138,13 @@ module RGeo
       # Gets axis details for dimension within coordinate system. Each
       # dimension in the coordinate system has a corresponding axis.
       def get_axis(dimension)
-        _axis_and_unit_info(dimension).split(":")[0]
+        _axis_and_unit_info(dimension)&.first
       end
 
       # Gets units for dimension within coordinate system. Each
       # dimension in the coordinate system has corresponding units.
       def get_units(dimension)
-        _axis_and_unit_info(dimension).split(":")[1]
+        _axis_and_unit_info(dimension)&.last
       end
 
       # Returns true if this Proj4 object is a geographic (lat-long)
@@ -236,6 +248,19 @@ module RGeo
         #   radians as its units. If this is a geocentric or other type of
         #   coordinate system, this has no effect. Default is false.
         #   (That is all coordinates are in degrees by default.)
+        # [<tt>:cache</tt>]
+        #   If set to false, the definition is parsed again instead of
+        #   being looked up in the definition cache. Default is true, in
+        #   which case the returned object is a copy of the cached one,
+        #   sharing its native PJ. See Proj4.cache.
+        # [<tt>:lazy</tt>]
+        #   If set to true, the definition is only parsed by PROJ when the
+        #   coordinate system is first used, for instance to create a
+        #   transformation or to compare it, so that building many Proj4
+        #   objects that may never be used costs almost nothing. An invalid
+        #   definition is then only detected on first use, where
+        #   transformations raise Error::InvalidProjection. Default is
+        #   false.
 
         def create(defn_, opts_ = {})
           result_ = nil
@@ -245,16 +270,32 @@ module RGeo
             end
 
             defn_ = "EPSG:#{defn_}" if defn_.is_a?(Integer)
-
-            result_ = _create(defn_, opts_[:radians])
-            raise RGeo::Error::InvalidProjection unless result_._valid?
-
-            result_.dimension = result_._axis_count
+            radians_ = opts_[:radians] ? true : false
+            lazy_ = opts_[:lazy] ? true : false
+
+            if opts_.fetch(:cache, true) && Ractor.current == Ractor.main
+              cached_ = cache.fetch([normalize_definition(defn_), radians_, lazy_]) do
+                build(defn_, radians_, lazy_).freeze
+              end
+              result_ = cached_.dup
+              result_._set_original_str(defn_) unless cached_.original_str == defn_
+            else
+              result_ = build(defn_, radians_, lazy_)
+            end
           end
           result_
         end
         alias create_from_wkt create
 
+        # Returns the process-wide cache of the Proj4 objects copied by
+        # create, keyed on their definition and the radians and lazy
+        # options. Its capacity can be changed with
+        # <tt>Proj4.cache.capacity = n</tt> (nil for unbounded), and its
+        # counters read with <tt>Proj4.cache.stats</tt>. The cache is only
+        # used from the main Ractor.
+
+        attr_reader :cache
+
         # Create a new Proj4 object, given a definition, which may be
         # either a string or a hash. Raises Error::UnsupportedOperation
         # if the given definition is invalid or Proj4 is not supported.
@@ -278,6 +319,23 @@ module RGeo
           result_
         end
 
+        # Builds coordinate systems and transformation pipelines ahead of
+        # first use, typically in the master process of a preforking
+        # server. Processes forked afterwards share them, only their PROJ
+        # contexts are recreated.
+        #
+        # Each of +pairs+ is a <tt>[from, to]</tt> pair of Proj4 objects or
+        # definitions accepted by create, optionally followed by a Hash of
+        # the options accepted by CRSStore.get. The coordinate systems go
+        # to Proj4.cache and the pipelines to CRSStore, either of which may
+        # evict them later if given a capacity. Returns the CRSToCRS
+        # objects, in the order of +pairs+.
+        def preload(pairs)
+          pairs.map do |from, to, options|
+            CRSStore.get(preload_crs(from), preload_crs(to), **(options || {}))
+          end
+        end
+
         # Low-level coordinate transform method.
         # Transforms the given coordinate (x, y, [z]) from one proj4
         # coordinate system to another. Returns an array with either two
@@ -287,14 +345,80 @@ module RGeo
           crs_to_crs.transform_coords(x, y, z)
         end
 
+        # Batch coordinate transform method.
+        # Transforms a packed buffer of doubles from one proj4 coordinate
+        # system to another. See CRSToCRS#transform_buffer.
+        def transform_buffer(from_proj, to_proj, buffer, dimension = 2, **options)
+          crs_to_crs = CRSStore.get(from_proj, to_proj)
+          crs_to_crs.transform_buffer(buffer, dimension, **options)
+        end
+
+        # Asynchronous batch coordinate transform method, returning a
+        # TransformFuture. See CRSToCRS#transform_buffer_async.
+        def transform_buffer_async(from_proj, to_proj, buffer, dimension = 2, **options)
+          crs_to_crs = CRSStore.get(from_proj, to_proj)
+          crs_to_crs.transform_buffer_async(buffer, dimension, **options)
+        end
+
+        # Bounding box transform method.
+        # Transforms the bounding box (xmin, ymin, xmax, ymax) from one
+        # proj4 coordinate system to another. See CRSToCRS#transform_bounds.
+        def transform_bounds(from_proj, to_proj, xmin, ymin, xmax, ymax, **options)
+          crs_to_crs = CRSStore.get(from_proj, to_proj)
+          crs_to_crs.transform_bounds(xmin, ymin, xmax, ymax, **options)
+        end
+
+        # WKB transform method.
+        # Transforms a WKB or EWKB geometry from one proj4 coordinate
+        # system to another. See CRSToCRS#transform_wkb.
+        def transform_wkb(from_proj, to_proj, wkb, **options)
+          crs_to_crs = CRSStore.get(from_proj, to_proj)
+          crs_to_crs.transform_wkb(wkb, **options)
+        end
+
+        # EWKB transform method, setting the SRID of the result. See
+        # CRSToCRS#transform_ewkb.
+        def transform_ewkb(from_proj, to_proj, ewkb, srid = to_proj.authority_code, **options)
+          crs_to_crs = CRSStore.get(from_proj, to_proj)
+          crs_to_crs.transform_ewkb(ewkb, srid, **options)
+        end
+
         # Low-level geometry transform method.
         # Transforms the given geometry between the given two projections.
         # The resulting geometry is constructed using the to_factory.
         # Any projections associated with the factories themselves are
-        # ignored.
-        def transform(from_proj, from_geometry, to_proj, to_factory)
+        # ignored. See CRSToCRS#transform for the options.
+        def transform(from_proj, from_geometry, to_proj, to_factory, **options)
+          crs_to_crs = CRSStore.get(from_proj, to_proj)
+          crs_to_crs.transform(from_geometry, to_factory, **options)
+        end
+
+        # Asynchronous geometry transform method, returning a
+        # TransformFuture whose value is the geometry built by to_factory.
+        # See CRSToCRS#transform_async.
+        def transform_async(from_proj, from_geometry, to_proj, to_factory)
           crs_to_crs = CRSStore.get(from_proj, to_proj)
-          crs_to_crs.transform(from_geometry, to_factory)
+          crs_to_crs.transform_async(from_geometry, to_factory)
+        end
+
+        private
+
+        def build(defn_, radians_, lazy_)
+          result_ = _create(defn_, radians_, lazy_)
+          raise RGeo::Error::InvalidProjection unless lazy_ || result_._valid?
+
+          result_
+        end
+
+        # Definitions differing only by surrounding whitespace or by the
+        # case of an authority name share a cache entry.
+        def normalize_definition(defn_)
+          defn_ = defn_.to_s.strip
+          defn_ =~ /\A(\w+):(\w+)\z/ ? "#{Regexp.last_match(1).upcase}:#{Regexp.last_match(2)}" : defn_
+        end
+
+        def preload_crs(defn_)
+          defn_.is_a?(self) ? defn_ : new(defn_)
         end
       end
     end
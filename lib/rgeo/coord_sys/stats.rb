@@ -0,0 +1,35 @@
+# frozen_string_literal: true
+
+module RGeo
+  module CoordSys
+    class << self
+      # Returns process-wide counters of the work done by PROJ, to attribute
+      # latency to projection work.
+      #
+      # [<tt>:crs_created</tt>] CRSs created with proj_create
+      # [<tt>:crs_create_time</tt>] seconds spent creating them
+      # [<tt>:pipelines_created</tt>] CRSToCRS pipelines created
+      # [<tt>:pipeline_create_time</tt>] seconds spent creating them
+      # [<tt>:points_transformed</tt>] coordinates transformed
+      # [<tt>:proj_errors</tt>] failed creations and transformations
+      # [<tt>:crs_store</tt>] CRSStore counters, see Cache#stats
+      # [<tt>:proj4_cache</tt>] Proj4.cache counters, see Cache#stats
+      #
+      # Returns an empty Hash if Proj4 is not supported.
+      def stats
+        return {} unless Proj4.supported?
+
+        _native_stats.merge(crs_store: CRSStore.stats, proj4_cache: Proj4.cache.stats)
+      end
+
+      # Resets the counters returned by stats.
+      def reset_stats
+        return unless Proj4.supported?
+
+        _reset_native_stats
+        CRSStore.instance.reset_stats
+        Proj4.cache.reset_stats
+      end
+    end
+  end
+end
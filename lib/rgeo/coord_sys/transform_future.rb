@@ -0,0 +1,53 @@
+# frozen_string_literal: true
+
+require "io/wait"
+
+module RGeo
+  module CoordSys
+    # Result of a transformation running on the native worker threads,
+    # returned by CRSToCRS#transform_buffer_async and
+    # CRSToCRS#transform_async.
+    #
+    # Completion is signalled through a pipe and waited for with
+    # IO#wait_readable, so under a Fiber.scheduler (such as the one of
+    # the async gem, used by Falcon) only the waiting fiber is suspended
+    # and the others keep running. Without a scheduler, the waiting
+    # thread releases the GVL.
+    #
+    #   future = crs_to_crs.transform_buffer_async(buffer)
+    #   # ... serve other requests ...
+    #   future.value # => buffer, once transformed
+    class TransformFuture
+      # Whether the transformation is done, without waiting for it.
+      def done?
+        _done?
+      end
+
+      # Waits for the transformation to be done, at most +timeout+
+      # seconds when given. Returns whether it is done.
+      def wait(timeout = nil)
+        @reader.wait_readable(timeout) unless _done?
+        _done?
+      rescue IOError
+        # The result was collected, closing the pipe, while waiting.
+        _done?
+      end
+
+      # Waits for the transformation and returns its result, as the
+      # synchronous method would. Raises Error::TransformError when it
+      # was stopped by a failure with <tt>on_error: :raise</tt>.
+      def value
+        wait
+        @reader.close unless @reader.closed?
+        @value = @finish.call(_value) unless defined?(@value)
+        @value
+      end
+
+      def attach(reader, finish) # :nodoc:
+        @reader = reader
+        @finish = finish
+        self
+      end
+    end
+  end
+end
@@ -0,0 +1,55 @@
+# frozen_string_literal: true
+
+module RGeo
+  module CoordSys
+    # Outcome of a batch transformation, filled in when given as the
+    # <tt>status:</tt> option of CRSToCRS#transform_buffer,
+    # CRSToCRS#transform_columns, CRSToCRS#transform_arrow,
+    # CRSToCRS#transform_wkb or CRSToCRS#transform.
+    #
+    #   status = RGeo::CoordSys::TransformStatus.new
+    #   crs_to_crs.transform_buffer(buffer, status: status)
+    #   status.failed_indices # => coordinates PROJ could not transform
+    class TransformStatus
+      # Number of coordinates in the batch.
+      attr_reader :count
+
+      # Number of coordinates PROJ could not transform.
+      attr_reader :failures
+
+      # Bitmap with a bit set for each coordinate that was transformed,
+      # least significant bit first, as the validity bitmap of an Arrow
+      # array. Coordinates left out by <tt>on_error: :raise</tt> are
+      # unset.
+      attr_reader :validity
+
+      def initialize
+        @count = 0
+        @failures = 0
+        @validity = "".b
+      end
+
+      def success?
+        @failures.zero?
+      end
+
+      # Whether the coordinate at +index+ was transformed.
+      def valid?(index)
+        index >= 0 && index < @count && @validity.getbyte(index >> 3)[index & 7] == 1
+      end
+
+      # Indices of the coordinates that were not transformed.
+      def failed_indices
+        bits = @validity.unpack1("b*")
+        (0...@count).select { |index| bits[index] == "0" }
+      end
+
+      def update(count, failures, validity) # :nodoc:
+        @count = count
+        @failures = failures
+        @validity = validity
+        self
+      end
+    end
+  end
+end
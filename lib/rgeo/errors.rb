@@ -11,5 +11,12 @@ module RGeo
     # RGeo error specific to the PROJ library
     class InvalidProjection < RGeoError
     end
+
+    # Raised by batch transforms run with <tt>on_error: :raise</tt> when
+    # PROJ fails to transform a coordinate.
+    class TransformError < InvalidProjection
+      # Index of the first coordinate that could not be transformed.
+      attr_reader :index
+    end
   end
 end
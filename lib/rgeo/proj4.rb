@@ -3,8 +3,13 @@
 require "rgeo"
 require "rgeo/proj4/version"
 require "rgeo/coord_sys/proj4_c_impl"
+require "rgeo/coord_sys/cache"
+require "rgeo/coord_sys/pipeline_cache"
+require "rgeo/coord_sys/transform_status"
+require "rgeo/coord_sys/transform_future"
 require "rgeo/coord_sys/crs_to_crs"
 require "rgeo/coord_sys/proj4"
+require "rgeo/coord_sys/stats"
 require_relative "./errors"
 
 module RGeo
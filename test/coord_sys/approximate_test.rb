@@ -0,0 +1,104 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestCoordSysApproximate < Minitest::Test # :nodoc:
+  BOUNDS = [0.0, 40.0, 6.0, 50.0].freeze
+
+  def setup
+    from = RGeo::CoordSys::Proj4.create("+proj=longlat +datum=WGS84 +no_defs +type=crs")
+    to = RGeo::CoordSys::Proj4.create("+proj=utm +zone=31 +datum=WGS84 +units=m +no_defs +type=crs")
+    @exact = RGeo::CoordSys::CRSToCRS.create(from, to)
+  end
+
+  # Points on a lattice that does not line up with the cells of the grid.
+  def lattice(bounds, steps)
+    xmin, ymin, xmax, ymax = bounds
+    (0..steps).flat_map do |i|
+      (0..steps).flat_map do |j|
+        [xmin + (xmax - xmin) * i / steps, ymin + (ymax - ymin) * j / steps]
+      end
+    end
+  end
+
+  def max_error(expected, actual)
+    expected.each_slice(2).zip(actual.each_slice(2)).map do |(ex, ey), (ax, ay)|
+      Math.hypot(ex - ax, ey - ay)
+    end.max
+  end
+
+  def test_error_bound
+    coords = lattice(BOUNDS, 317)
+    [1.0, 0.01, 0.0001].each do |bound|
+      approximate = @exact.approximate(BOUNDS, max_error: bound)
+      expected = coords.pack("d*")
+      actual = coords.pack("d*")
+      @exact.transform_buffer(expected)
+      approximate.transform_buffer(actual)
+      assert_operator(max_error(expected.unpack("d*"), actual.unpack("d*")), :<=, bound)
+    end
+  end
+
+  def test_outside_bounds_is_exact
+    approximate = @exact.approximate(BOUNDS, max_error: 1.0)
+    coords = [-1.0, 45.0, 3.0, 51.0]
+    expected = coords.pack("d*")
+    actual = coords.pack("d*")
+    @exact.transform_buffer(expected)
+    approximate.transform_buffer(actual)
+    assert_equal(expected.unpack("d*"), actual.unpack("d*"))
+  end
+
+  def test_transform_coords
+    approximate = @exact.approximate(BOUNDS, max_error: 0.001)
+    expected = @exact.transform_coords(2.35, 48.85, nil)
+    actual = approximate.transform_coords(2.35, 48.85, nil)
+    assert_in_delta(expected[0], actual[0], 0.001)
+    assert_in_delta(expected[1], actual[1], 0.001)
+    assert_equal(@exact.transform_coords(2.35, 48.85, 10.0), approximate.transform_coords(2.35, 48.85, 10.0))
+  end
+
+  def lattice_line(factory)
+    factory.line_string(lattice([1.0, 42.0, 5.0, 49.0], 5).each_slice(2).map { |x, y| factory.point(x, y) })
+  end
+
+  # Interpolated results are close to, but not exactly, the exact ones.
+  def assert_interpolated(expected, actual, bound)
+    error = max_error(expected, actual)
+    assert_operator(error, :>, 0.0)
+    assert_operator(error, :<=, bound)
+  end
+
+  def test_transform_geometry
+    from_factory = RGeo::Cartesian.simple_factory(srid: 4326, coord_sys: @exact.source_cs)
+    to_factory = RGeo::Cartesian.simple_factory(srid: 32_631, coord_sys: @exact.target_cs)
+    line = lattice_line(from_factory)
+    approximate = @exact.approximate(BOUNDS, max_error: 0.01)
+    expected = @exact.transform(line, to_factory).coordinates.flatten
+    actual = approximate.transform(line, to_factory).coordinates.flatten
+    assert_interpolated(expected, actual, 0.01)
+  end
+
+  def test_transform_wkb
+    wkb = RGeo::WKRep::WKBGenerator.new.generate(lattice_line(RGeo::Cartesian.simple_factory(srid: 4326)))
+    approximate = @exact.approximate(BOUNDS, max_error: 0.01)
+    parser = RGeo::WKRep::WKBParser.new(RGeo::Cartesian.simple_factory(srid: 32_631))
+    expected = parser.parse(@exact.transform_wkb(wkb)).coordinates.flatten
+    actual = parser.parse(approximate.transform_wkb(wkb)).coordinates.flatten
+    assert_interpolated(expected, actual, 0.01)
+  end
+
+  def test_approximation
+    assert_nil(@exact.approximation)
+    approximate = @exact.approximate(BOUNDS, max_error: 1)
+    assert_equal({ bounds: BOUNDS, max_error: 1.0 }, approximate.approximation)
+    assert_equal(@exact.source_cs, approximate.source_cs)
+    assert_nil(approximate.inverse.approximation)
+  end
+
+  def test_invalid_arguments
+    assert_raises(ArgumentError) { @exact.approximate([1.0, 2.0, 1.0, 3.0], max_error: 1) }
+    assert_raises(ArgumentError) { @exact.approximate(BOUNDS, max_error: 0) }
+    assert_raises(ArgumentError) { @exact.approximate(BOUNDS[0, 3], max_error: 1) }
+  end
+end
@@ -0,0 +1,173 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestCoordSysAsync < Minitest::Test # :nodoc:
+  # Bare-bones scheduler running fibers until they all wait on nothing.
+  class Scheduler
+    def initialize
+      @readable = {}
+      @ready = []
+    end
+
+    def io_wait(io, events, _timeout)
+      @readable[io] = Fiber.current
+      Fiber.yield
+      events
+    end
+
+    def kernel_sleep(_duration = nil)
+      @ready << Fiber.current
+      Fiber.yield
+    end
+
+    def block(_blocker, _timeout = nil)
+      raise NotImplementedError
+    end
+
+    def unblock(_blocker, fiber)
+      @ready << fiber
+    end
+
+    def fiber(&block)
+      fiber = Fiber.new(blocking: false, &block)
+      fiber.resume
+      fiber
+    end
+
+    def close
+      until @readable.empty? && @ready.empty?
+        @ready.shift.resume until @ready.empty?
+        next if @readable.empty?
+
+        readable, = IO.select(@readable.keys, nil, nil, 0.001)
+        readable&.each { |io| @readable.delete(io).resume }
+      end
+    end
+  end
+
+  def setup
+    @crs_to_crs = RGeo::CoordSys::CRSToCRS.create(RGeo::CoordSys::Proj4.create("EPSG:2154"),
+                                                  RGeo::CoordSys::Proj4.create("EPSG:4326"))
+  end
+
+  def coords(count)
+    Array.new(count) { |i| [700_000.0 + i, 6_600_000.0 + (i % 1000)] }.flatten
+  end
+
+  def test_transform_buffer_async
+    buffer = coords(1000).pack("d*")
+    expected = @crs_to_crs.transform_buffer(buffer.dup)
+
+    future = @crs_to_crs.transform_buffer_async(buffer)
+    assert_instance_of(RGeo::CoordSys::TransformFuture, future)
+    assert(future.wait)
+    assert(future.done?)
+    # Results are written when collected.
+    assert_equal(coords(1000).pack("d*"), buffer)
+    assert_same(buffer, future.value)
+    assert_equal(expected, buffer)
+    assert_same(buffer, future.value)
+  end
+
+  def test_transform_buffer_async_out
+    input = coords(10).pack("d*").freeze
+    out = "\0".b * input.bytesize
+
+    assert_same(out, @crs_to_crs.transform_buffer_async(input, out: out).value)
+    assert_equal(@crs_to_crs.transform_buffer(input.dup), out)
+  end
+
+  def test_transform_buffer_async_parallel
+    workers = RGeo::CoordSys::CRSToCRS.workers
+    RGeo::CoordSys::CRSToCRS.workers = 4
+    buffer = coords(100_000).pack("d*")
+    futures = Array.new(3) { @crs_to_crs.transform_buffer_async(buffer.dup) }
+
+    expected = @crs_to_crs.transform_buffer(buffer)
+    futures.each { |future| assert_equal(expected, future.value) }
+  ensure
+    RGeo::CoordSys::CRSToCRS.workers = workers
+  end
+
+  def test_transform_buffer_async_status
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(RGeo::CoordSys::Proj4.create("EPSG:4326"),
+                                                 RGeo::CoordSys::Proj4.create("EPSG:3857"))
+    status = RGeo::CoordSys::TransformStatus.new
+    buffer = [1.0, 2.0, 0.0, 90.0, 3.0, 4.0].pack("d*")
+
+    crs_to_crs.transform_buffer_async(buffer, on_error: :nan, status: status).value
+    assert_equal(3, status.count)
+    assert_equal([1], status.failed_indices)
+    assert(buffer.unpack("d*")[2, 2].all?(&:nan?))
+
+    status = RGeo::CoordSys::TransformStatus.new
+    future = crs_to_crs.transform_buffer_async([1.0, 2.0, 0.0, 90.0].pack("d*"), on_error: :raise, status: status)
+    error = assert_raises(RGeo::Error::TransformError) { future.value }
+    assert_equal(1, error.index)
+    assert_equal([1], status.failed_indices)
+    assert_raises(RGeo::Error::TransformError) { future.value }
+  end
+
+  def test_transform_buffer_async_invalid_arguments
+    assert_raises(ArgumentError) { @crs_to_crs.transform_buffer_async([1.0, 2.0].pack("d*"), 4) }
+    assert_raises(ArgumentError) { @crs_to_crs.transform_buffer_async([1.0, 2.0].pack("d*"), on_error: :skip) }
+    assert_raises(ArgumentError) { @crs_to_crs.transform_buffer_async([1.0, 2.0, 3.0].pack("d*")) }
+  end
+
+  def test_transform_async
+    from_factory = RGeo::Cartesian.simple_factory(srid: 2154, coord_sys: @crs_to_crs.source_cs)
+    to_factory = RGeo::Cartesian.simple_factory(srid: 4326, coord_sys: @crs_to_crs.target_cs)
+    points = [[700_000.0, 6_600_000.0], [701_000.0, 6_600_000.0], [701_000.0, 6_601_000.0],
+              [700_000.0, 6_601_000.0], [700_000.0, 6_600_000.0]].map { |x, y| from_factory.point(x, y) }
+    ring = from_factory.linear_ring(points)
+    geometries = [
+      points.first,
+      from_factory.line_string(points),
+      from_factory.polygon(ring),
+      from_factory.multi_polygon([from_factory.polygon(ring)]),
+      from_factory.collection([points.first, from_factory.line_string(points)]),
+      from_factory.collection([from_factory.collection([from_factory.multi_polygon([from_factory.polygon(ring)])])])
+    ]
+
+    geometries.each do |geometry|
+      expected = @crs_to_crs.transform(geometry, to_factory)
+      assert_equal(expected.as_text, @crs_to_crs.transform_async(geometry, to_factory).value.as_text)
+    end
+  end
+
+  def test_proj4_methods
+    from = RGeo::CoordSys::Proj4.create("EPSG:2154")
+    to = RGeo::CoordSys::Proj4.create("EPSG:4326")
+    buffer = coords(10).pack("d*")
+    from_factory = RGeo::Cartesian.simple_factory(srid: 2154, coord_sys: from)
+    to_factory = RGeo::Cartesian.simple_factory(srid: 4326, coord_sys: to)
+    point = from_factory.point(700_000.0, 6_600_000.0)
+
+    assert_equal(RGeo::CoordSys::Proj4.transform_buffer(from, to, buffer.dup),
+                 RGeo::CoordSys::Proj4.transform_buffer_async(from, to, buffer).value)
+    assert_equal(RGeo::CoordSys::Proj4.transform(from, point, to, to_factory).as_text,
+                 RGeo::CoordSys::Proj4.transform_async(from, point, to, to_factory).value.as_text)
+  end
+
+  def test_fiber_scheduler
+    buffer = coords(100_000).pack("d*")
+    expected = @crs_to_crs.transform_buffer(buffer.dup)
+    scheduler = Scheduler.new
+    steps = 0
+
+    Thread.new do
+      Fiber.set_scheduler(scheduler)
+      Fiber.schedule { @crs_to_crs.transform_buffer_async(buffer).value }
+      Fiber.schedule do
+        3.times do
+          steps += 1
+          sleep(0)
+        end
+      end
+    end.join
+
+    assert_equal(expected, buffer)
+    assert_equal(3, steps)
+  end
+end
@@ -1,6 +1,7 @@
 # frozen_string_literal: true
 
 require "test_helper"
+require "tmpdir"
 
 class TestCrsToCrs < Minitest::Test # :nodoc:
   def from
@@ -61,6 +62,93 @@ class TestCrsToCrs < Minitest::Test # :nodoc:
     assert_equal(crs_to_crs.target_cs, inverse_crs_to_crs.source_cs)
   end
 
+  def test_inverse_transform
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+    inverse_crs_to_crs = crs_to_crs.inverse
+    expected = RGeo::CoordSys::CRSToCRS.create(to, from).transform_coords(3.0, 47.0, nil)
+    result = inverse_crs_to_crs.transform_coords(3.0, 47.0, nil)
+    assert_in_delta(expected[0], result[0], 1e-6)
+    assert_in_delta(expected[1], result[1], 1e-6)
+
+    buffer = [3.0, 47.0].pack("d*")
+    inverse_crs_to_crs.transform_buffer(buffer)
+    assert_in_delta(expected[0], buffer.unpack("d*")[0], 1e-6)
+    assert_in_delta(expected[1], buffer.unpack("d*")[1], 1e-6)
+  end
+
+  def test_create_with_area_of_interest
+    expected = RGeo::CoordSys::CRSToCRS.create(from, to).transform_coords(733_345.6496818807, 6_750_247.713332973, nil)
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to, area: [-5.0, 42.0, 8.0, 51.0], allow_ballpark: false)
+    result = crs_to_crs.transform_coords(733_345.6496818807, 6_750_247.713332973, nil)
+    assert_in_delta(expected[0], result[0], 1e-6)
+    assert_in_delta(expected[1], result[1], 1e-6)
+    assert_equal({ area: [-5.0, 42.0, 8.0, 51.0], allow_ballpark: false }, crs_to_crs.operation_options)
+    assert_equal(crs_to_crs.operation_options, crs_to_crs.inverse.operation_options)
+  end
+
+  def test_policy
+    ed50 = RGeo::CoordSys::Proj4.create("EPSG:4230")
+    wgs84 = RGeo::CoordSys::Proj4.create("EPSG:4326")
+
+    no_grids = RGeo::CoordSys::CRSToCRS.create(ed50, wgs84, policy: :no_grids)
+    assert_equal(:no_grids, no_grids.policy)
+    assert_equal(0, no_grids.operation[:grids])
+    refute(no_grids.operation[:ballpark])
+    assert_equal(:no_grids, no_grids.inverse.policy)
+
+    fastest = RGeo::CoordSys::CRSToCRS.create(ed50, wgs84, policy: :fastest)
+    assert(fastest.operation[:ballpark])
+    assert_equal([2.0, 45.0], fastest.transform_coords(2.0, 45.0, nil).map { |v| v.round(9) })
+
+    assert_equal(:best, RGeo::CoordSys::CRSToCRS.create(from, to).policy)
+    assert_raises(ArgumentError) { RGeo::CoordSys::CRSToCRS.create(from, to, policy: :quick) }
+    assert_raises(ArgumentError) { RGeo::CoordSys::CRSToCRS.default_policy = :quick }
+  end
+
+  def test_default_policy
+    RGeo::CoordSys::CRSToCRS.default_policy = :no_grids
+    assert_equal(:no_grids, RGeo::CoordSys::CRSToCRS.create(from, to).policy)
+    assert_equal(:no_grids, RGeo::CoordSys::CRSStore.get(from, to).policy)
+  ensure
+    RGeo::CoordSys::CRSToCRS.default_policy = :best
+  end
+
+  def test_pipeline_cache
+    Dir.mktmpdir do |dir|
+      RGeo::CoordSys::CRSToCRS.pipeline_cache = dir
+      created = RGeo::CoordSys::CRSToCRS.create(from, to)
+      assert_equal(1, Dir.glob(File.join(dir, "*.json")).size)
+
+      cached = RGeo::CoordSys::CRSToCRS.create(from, to)
+      assert_equal(created.to_wkt, cached.to_wkt)
+      assert_equal(created.transform_coords(733_345.6496818807, 6_750_247.713332973, nil),
+                   cached.transform_coords(733_345.6496818807, 6_750_247.713332973, nil))
+
+      Dir.glob(File.join(dir, "*.json")).each { |file| File.write(file, "garbage") }
+      assert_equal(created.to_wkt, RGeo::CoordSys::CRSToCRS.create(from, to).to_wkt)
+      assert_equal(created._definition, File.read(Dir.glob(File.join(dir, "*.json")).first))
+    ensure
+      RGeo::CoordSys::CRSToCRS.pipeline_cache = nil
+    end
+  end
+
+  def test_pipeline_cache_skips_candidates
+    Dir.mktmpdir do |dir|
+      RGeo::CoordSys::CRSToCRS.pipeline_cache = dir
+      # NAD27 to WGS84 keeps several candidate operations.
+      crs_to_crs = RGeo::CoordSys::CRSToCRS.create(RGeo::CoordSys::Proj4.create("EPSG:4267"),
+                                                   RGeo::CoordSys::Proj4.create("EPSG:4326"))
+      assert_nil(crs_to_crs._definition)
+      assert_empty(Dir.glob(File.join(dir, "*.json")))
+    ensure
+      RGeo::CoordSys::CRSToCRS.pipeline_cache = nil
+    end
+  end
+
+  def test_create_with_invalid_area
+    assert_raises(ArgumentError) { RGeo::CoordSys::CRSToCRS.create(from, to, area: [0.0, 0.0]) }
+  end
+
   def test_transform_coords
     crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
     a, b = crs_to_crs.transform_coords(733_345.6496818807, 6_750_247.713332973, nil)
@@ -101,6 +189,347 @@ class TestCrsToCrs < Minitest::Test # :nodoc:
     assert_close_enough(b, 47.85177684510492)
   end
 
+  def test_transform_buffer
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+    coords = [733_345.6496818807, 6_750_247.713332973, 784_020.1897824854, 6_722_964.293806808]
+    buffer = coords.pack("d*")
+
+    result = crs_to_crs.transform_buffer(buffer)
+    assert_same(buffer, result)
+    a, b, c, d = buffer.unpack("d*")
+    assert_close_enough(a, 3.4458703379573348)
+    assert_close_enough(b, 47.85177684510492)
+    assert_close_enough(c, 4.118218755627164)
+    assert_close_enough(d, 47.60170379156289)
+  end
+
+  def test_transform_buffer_3d
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+    buffer = [733_345.6496818807, 6_750_247.713332973, 0.0].pack("d*")
+    expected = crs_to_crs.transform_coords(733_345.6496818807, 6_750_247.713332973, 0.0)
+
+    crs_to_crs.transform_buffer(buffer, 3).unpack("d*").zip(expected).each do |actual, exp|
+      assert_close_enough(actual, exp)
+    end
+  end
+
+  def test_transform_buffer_out
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+    input = [733_345.6496818807, 6_750_247.713332973].pack("d*").freeze
+    out = "\0".b * input.bytesize
+
+    assert_same(out, crs_to_crs.transform_buffer(input, out: out))
+    assert_equal([733_345.6496818807, 6_750_247.713332973], input.unpack("d*"))
+    a, b = out.unpack("d*")
+    assert_close_enough(a, 3.4458703379573348)
+    assert_close_enough(b, 47.85177684510492)
+  end
+
+  def test_transform_buffer_io_buffer
+    skip "IO::Buffer not available" unless defined?(IO::Buffer)
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+    data = [733_345.6496818807, 6_750_247.713332973].pack("d*")
+    buffer = IO::Buffer.new(data.bytesize)
+    buffer.set_string(data)
+
+    crs_to_crs.transform_buffer(buffer)
+    a, b = buffer.get_string.unpack("d*")
+    assert_close_enough(a, 3.4458703379573348)
+    assert_close_enough(b, 47.85177684510492)
+  end
+
+  def test_transform_buffer_parallel
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+    workers = RGeo::CoordSys::CRSToCRS.workers
+    RGeo::CoordSys::CRSToCRS.workers = 4
+    coords = Array.new(100_000) { |i| [700_000.0 + i, 6_700_000.0 + (i % 1000)] }.flatten
+    serial = crs_to_crs.transform_buffer(coords.pack("d*"))
+    parallel = crs_to_crs.transform_buffer(coords.pack("d*"), parallel: true)
+
+    assert_equal(serial, parallel)
+  ensure
+    RGeo::CoordSys::CRSToCRS.workers = workers
+  end
+
+  def test_workers
+    assert_operator(RGeo::CoordSys::CRSToCRS.workers, :>=, 1)
+    assert_raises(ArgumentError) { RGeo::CoordSys::CRSToCRS.workers = 0 }
+  end
+
+  def test_transform_buffer_status
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(RGeo::CoordSys::Proj4.create("EPSG:4326"),
+                                                 RGeo::CoordSys::Proj4.create("EPSG:3857"))
+    status = RGeo::CoordSys::TransformStatus.new
+    buffer = [1.0, 2.0, 0.0, 90.0, 3.0, 4.0].pack("d*")
+
+    crs_to_crs.transform_buffer(buffer, status: status)
+    assert_equal(3, status.count)
+    assert_equal(1, status.failures)
+    assert_equal([1], status.failed_indices)
+    assert(status.valid?(2))
+    refute(status.valid?(1))
+    assert_equal(Float::INFINITY, buffer.unpack("d*")[2])
+
+    buffer = [1.0, 2.0, 0.0, 90.0].pack("d*")
+    crs_to_crs.transform_buffer(buffer, on_error: :nan)
+    assert(buffer.unpack("d*")[2, 2].all?(&:nan?))
+
+    error = assert_raises(RGeo::Error::TransformError) do
+      crs_to_crs.transform_buffer([1.0, 2.0, 0.0, 90.0, 3.0, 4.0].pack("d*"), on_error: :raise, status: status)
+    end
+    assert_equal(1, error.index)
+    assert_equal(1, status.failures)
+    assert(status.valid?(0))
+    refute(status.valid?(1))
+    assert_raises(ArgumentError) { crs_to_crs.transform_buffer([1.0, 2.0].pack("d*"), on_error: :skip) }
+  end
+
+  def test_transform_bounds
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(RGeo::CoordSys::Proj4.create("EPSG:4326"),
+                                                 RGeo::CoordSys::Proj4.create("EPSG:3857"))
+    expected = [-1_113_194.9079327357, 4_865_942.279503176, 1_113_194.9079327357, 6_446_275.841017158]
+
+    crs_to_crs.transform_bounds(-10.0, 40.0, 10.0, 50.0).zip(expected) do |actual, value|
+      assert_in_delta(value, actual, 1e-3)
+    end
+    assert_raises(RGeo::Error::TransformError) { crs_to_crs.transform_bounds(0.0, 91.0, 10.0, 95.0) }
+    assert_raises(ArgumentError) { crs_to_crs.transform_bounds(0.0, 0.0, 1.0, 1.0, densify_pts: -1) }
+
+    status = RGeo::CoordSys::TransformStatus.new
+    buffer = [-10.0, 40.0, 10.0, 50.0, 0.0, 91.0, 10.0, 95.0].pack("d*")
+    crs_to_crs.transform_bounds_buffer(buffer, on_error: :nan, status: status)
+    assert_equal(2, status.count)
+    assert_equal([1], status.failed_indices)
+    buffer.unpack("d4").zip(expected) { |actual, value| assert_in_delta(value, actual, 1e-3) }
+    assert(buffer.unpack("d*")[4, 4].all?(&:nan?))
+  end
+
+  def test_transform_columns
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+    x = [733_345.6496818807, 784_020.1897824854].pack("d*")
+    y = [6_750_247.713332973, 6_722_964.293806808].pack("d*")
+
+    assert_equal([x, y], crs_to_crs.transform_columns(x, y))
+    assert_close_enough(x.unpack1("d"), 3.4458703379573348)
+    assert_close_enough(y.unpack1("d"), 47.85177684510492)
+    assert_close_enough(x.unpack("d*")[1], 4.118218755627164)
+    assert_close_enough(y.unpack("d*")[1], 47.60170379156289)
+  end
+
+  def test_transform_columns_stride_and_out
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+    x = [733_345.6496818807, 0.0, 784_020.1897824854, 0.0].pack("d*").freeze
+    y = [6_750_247.713332973, 0.0, 6_722_964.293806808, 0.0].pack("d*").freeze
+    out = ["\0".b * 24, "\0".b * 24]
+
+    assert_same(out, crs_to_crs.transform_columns(x, y, stride: 16, out: out))
+    assert_close_enough(out[0].unpack("d*")[2], 4.118218755627164)
+    assert_close_enough(out[1].unpack("d*")[2], 47.60170379156289)
+    assert_raises(ArgumentError) { crs_to_crs.transform_columns(x, y[0, 8], out: out) }
+    assert_raises(ArgumentError) { crs_to_crs.transform_columns(x, y, stride: 12, out: out) }
+  end
+
+  def test_transform_arrow
+    begin
+      require "fiddle"
+    rescue LoadError
+      skip "fiddle is not available"
+    end
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+    keep = []
+    x = arrow_column([733_345.6496818807, 784_020.1897824854], keep)
+    y = arrow_column([6_750_247.713332973, 6_722_964.293806808], keep)
+    out = ["\0".b * 16, "\0".b * 16]
+
+    crs_to_crs.transform_arrow(x, y, out: out)
+    assert_close_enough(out[0].unpack1("d"), 3.4458703379573348)
+    assert_close_enough(out[1].unpack("d*")[1], 47.60170379156289)
+
+    crs_to_crs.transform_arrow(x, y)
+    assert_equal(out[0], keep[0][0, 16])
+
+    int_schema = Fiddle::Pointer.malloc(72, Fiddle::RUBY_FREE)
+    int_schema[0, 72] = [Fiddle::Pointer["l"].to_i, 0, 0, 0, 0, 0, 0, 1, 0].pack("J3q2J4")
+    assert_raises(ArgumentError) { crs_to_crs.transform_arrow([x[0], int_schema.to_i], y) }
+  end
+
+  def test_transform_buffer_invalid
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+    assert_raises(ArgumentError) { crs_to_crs.transform_buffer([1.0, 2.0, 3.0].pack("d*")) }
+    assert_raises(ArgumentError) { crs_to_crs.transform_buffer([1.0, 2.0].pack("d*"), 4) }
+    assert_raises(ArgumentError) do
+      crs_to_crs.transform_buffer([1.0, 2.0].pack("d*"), out: [1.0].pack("d*"))
+    end
+    assert_raises(FrozenError) { crs_to_crs.transform_buffer([1.0, 2.0].pack("d*").freeze) }
+    assert_raises(TypeError) { crs_to_crs.transform_buffer([1.0, 2.0]) }
+  end
+
+  def test_transform_from_threads
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+    coords = Array.new(1_000) { |i| [733_345.6496818807 + i, 6_750_247.713332973 - i] }
+    expected = crs_to_crs.transform_buffer(coords.flatten.pack("d*")).unpack("d*")
+
+    threads = Array.new(4) do
+      Thread.new do
+        point = crs_to_crs.transform_coords(*coords[0], nil)
+        [point, crs_to_crs.transform_buffer(coords.flatten.pack("d*")).unpack("d*")]
+      end
+    end
+    threads.map(&:value).each do |point, values|
+      assert_equal(expected[0, 2], point)
+      assert_equal(expected, values)
+    end
+  end
+
+  def test_transform_line_string
+    from_factory = RGeo::Cartesian.simple_factory(srid: 2154, coord_sys: from)
+    to_factory = RGeo::Cartesian.simple_factory(srid: 4326, coord_sys: to)
+    line = from_factory.parse_wkt("LINESTRING (733345.6496818807 6750247.713332973, 784020.1897824854 6722964.293806808)")
+
+    result = RGeo::CoordSys::CRSToCRS.create(from, to).transform(line, to_factory)
+    assert_equal(RGeo::Feature::LineString, result.geometry_type)
+    assert_equal(to_factory, result.factory)
+    assert_close_enough(result.point_n(0).x, 3.4458703379573348)
+    assert_close_enough(result.point_n(0).y, 47.85177684510492)
+    assert_close_enough(result.point_n(1).x, 4.118218755627164)
+    assert_close_enough(result.point_n(1).y, 47.60170379156289)
+  end
+
+  def test_transform_wkb
+    from_factory = RGeo::Cartesian.simple_factory(srid: 2154, coord_sys: from)
+    to_factory = RGeo::Cartesian.simple_factory(srid: 4326, coord_sys: to)
+    line = from_factory.parse_wkt("LINESTRING (733345.6496818807 6750247.713332973, 784020.1897824854 6722964.293806808)")
+    wkb = RGeo::WKRep::WKBGenerator.new.generate(line)
+
+    result = RGeo::CoordSys::CRSToCRS.create(from, to).transform_wkb(wkb)
+    assert_equal(wkb.bytesize, result.bytesize)
+    assert_equal(Encoding::BINARY, result.encoding)
+    result = RGeo::WKRep::WKBParser.new(to_factory).parse(result)
+    assert_close_enough(result.point_n(0).x, 3.4458703379573348)
+    assert_close_enough(result.point_n(0).y, 47.85177684510492)
+    assert_close_enough(result.point_n(1).x, 4.118218755627164)
+    assert_close_enough(result.point_n(1).y, 47.60170379156289)
+  end
+
+  def test_transform_ewkb
+    from_factory = RGeo::Cartesian.simple_factory(srid: 2154, coord_sys: from, has_m_coordinate: true)
+    point = from_factory.parse_wkt("POINT M (733345.6496818807 6750247.713332973 7)")
+    generator = RGeo::WKRep::WKBGenerator.new(type_format: :ewkb, emit_ewkb_srid: true, little_endian: true)
+    ewkb = generator.generate(point)
+
+    result = RGeo::CoordSys::CRSToCRS.create(from, to).transform_ewkb(ewkb, 4326)
+    _order, type, srid, x, y, m = result.unpack("CVVE3")
+    assert_equal(0x60000001, type)
+    assert_equal(4326, srid)
+    assert_close_enough(x, 3.4458703379573348)
+    assert_close_enough(y, 47.85177684510492)
+    assert_equal(7.0, m)
+
+    result = RGeo::CoordSys::CRSToCRS.create(from, to).transform_ewkb(ewkb, nil)
+    assert_equal(0x40000001, result.unpack1("xV"))
+    assert_equal(ewkb.bytesize - 4, result.bytesize)
+  end
+
+  def test_transform_status
+    from = RGeo::CoordSys::Proj4.create("EPSG:4326")
+    to = RGeo::CoordSys::Proj4.create("EPSG:3857")
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+    from_factory = RGeo::Cartesian.simple_factory(srid: 4326, coord_sys: from)
+    to_factory = RGeo::Cartesian.simple_factory(srid: 3857, coord_sys: to)
+    line = from_factory.parse_wkt("LINESTRING (1 2, 0 90, 3 4)")
+    collection = from_factory.collection([from_factory.point(5, 6), line])
+    status = RGeo::CoordSys::TransformStatus.new
+
+    result = crs_to_crs.transform(line, to_factory, on_error: :nan, status: status)
+    assert_equal([1], status.failed_indices)
+    assert(result.point_n(1).x.nan?)
+    crs_to_crs.transform(collection, to_factory, status: status)
+    assert_equal(4, status.count)
+    assert_equal([2], status.failed_indices)
+    error = assert_raises(RGeo::Error::TransformError) do
+      crs_to_crs.transform(line, to_factory, on_error: :raise, status: status)
+    end
+    assert_equal(1, error.index)
+    assert_equal(3, status.count)
+    assert_equal(1, status.failures)
+
+    wkb = RGeo::WKRep::WKBGenerator.new.generate(line)
+    result = crs_to_crs.transform_wkb(wkb, on_error: :nan, status: status)
+    assert_equal(3, status.count)
+    assert_equal([1], status.failed_indices)
+    assert(RGeo::WKRep::WKBParser.new(to_factory).parse(result).point_n(1).y.nan?)
+    error = assert_raises(RGeo::Error::TransformError) { crs_to_crs.transform_ewkb(wkb, on_error: :raise) }
+    assert_equal(1, error.index)
+  end
+
+  def test_transform_wkb_invalid
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+    assert_raises(ArgumentError) { crs_to_crs.transform_wkb("\x01\x02\x00\x00\x00\x05\x00\x00\x00".b) }
+    assert_raises(ArgumentError) { crs_to_crs.transform_wkb("".b) }
+  end
+
+  def test_transform_polygon_with_hole
+    from_factory = RGeo::Cartesian.simple_factory(srid: 2154, coord_sys: from)
+    to_factory = RGeo::Cartesian.simple_factory(srid: 4326, coord_sys: to)
+    polygon = from_factory.parse_wkt(
+      "POLYGON ((700000 6600000, 800000 6600000, 800000 6700000, 700000 6600000), " \
+      "(750000 6620000, 780000 6620000, 780000 6650000, 750000 6620000))"
+    )
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+
+    result = crs_to_crs.transform(polygon, to_factory)
+    assert_equal(1, result.num_interior_rings)
+    [[polygon.exterior_ring, result.exterior_ring],
+     [polygon.interior_rings[0], result.interior_rings[0]]].each do |from_ring, to_ring|
+      assert_equal(from_ring.num_points, to_ring.num_points)
+      from_ring.points.zip(to_ring.points).each do |from_point, to_point|
+        x, y = crs_to_crs.transform_coords(from_point.x, from_point.y, nil)
+        assert_close_enough(x, to_point.x)
+        assert_close_enough(y, to_point.y)
+      end
+    end
+  end
+
+  def test_transform_nested_collection
+    from_factory = RGeo::Cartesian.simple_factory(srid: 2154, coord_sys: from)
+    to_factory = RGeo::Cartesian.simple_factory(srid: 4326, coord_sys: to)
+    collection = from_factory.parse_wkt(
+      "GEOMETRYCOLLECTION (POINT (700000 6600000), GEOMETRYCOLLECTION (" \
+      "MULTIPOLYGON (((700000 6600000, 800000 6600000, 800000 6700000, 700000 6600000)))))"
+    )
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+
+    result = crs_to_crs.transform(collection, to_factory)
+    multi_polygon = result.geometry_n(1).geometry_n(0)
+    assert_equal(RGeo::Feature::MultiPolygon, multi_polygon.geometry_type)
+    ring = collection.geometry_n(1).geometry_n(0).geometry_n(0).exterior_ring
+    ring.points.zip(multi_polygon.geometry_n(0).exterior_ring.points).each do |from_point, to_point|
+      x, y = crs_to_crs.transform_coords(from_point.x, from_point.y, nil)
+      assert_close_enough(x, to_point.x)
+      assert_close_enough(y, to_point.y)
+    end
+  end
+
+  def test_transform_passes_through_z_and_m
+    from_factory = RGeo::Cartesian.simple_factory(coord_sys: from, has_z_coordinate: true, has_m_coordinate: true)
+    to_factory = RGeo::Cartesian.simple_factory(coord_sys: to, has_z_coordinate: true, has_m_coordinate: true)
+    line = from_factory.line_string(
+      [
+        from_factory.point(733_345.6496818807, 6_750_247.713332973, 10, 42),
+        from_factory.point(784_020.1897824854, 6_722_964.293806808, 20, 43)
+      ]
+    )
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+
+    result = crs_to_crs.transform(line, to_factory)
+    assert_equal([42.0, 43.0], result.points.map(&:m))
+    assert_in_delta(10, result.point_n(0).z, 1e-2)
+    assert_in_delta(20, result.point_n(1).z, 1e-2)
+
+    point = crs_to_crs.transform(line.point_n(0), to_factory)
+    assert_equal(42.0, point.m)
+  end
+
   def test_store
     crs_to_crs1 = RGeo::CoordSys::CRSStore.get(from, to)
     crs_to_crs2 = RGeo::CoordSys::CRSStore.get(from, RGeo::CoordSys::Proj4.create("+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs +type=crs"))
@@ -109,4 +538,70 @@ class TestCrsToCrs < Minitest::Test # :nodoc:
     assert_equal(crs_to_crs1, crs_to_crs2)
     refute_equal(crs_to_crs1, crs_to_crs3)
   end
+
+  def test_store_stats
+    store = RGeo::CoordSys::CRSStore.send(:new)
+    store.get(from, to)
+    store.get(from, to)
+    stats = store.stats
+    assert_equal(1, stats[:size])
+    assert_equal(1, stats[:hits])
+    assert_equal(1, stats[:misses])
+    assert_equal(1, stats[:builds])
+    assert_operator(stats[:build_time], :>=, 0)
+  end
+
+  def test_store_builds_once_per_pair
+    store = RGeo::CoordSys::CRSStore.send(:new)
+    results = Array.new(8) { Thread.new { store.get(from, to) } }.map(&:value)
+    assert_equal(1, store.stats[:builds])
+    assert_equal(1, results.map(&:object_id).uniq.size)
+  end
+
+  def test_store_reuses_reverse_pair
+    store = RGeo::CoordSys::CRSStore.send(:new)
+    forward = store.get(from, to)
+    reverse = store.get(to, from)
+    refute_same(forward, reverse)
+    assert_equal(to, reverse.source_cs)
+    assert_equal(from, reverse.target_cs)
+    assert_equal(forward.to_wkt, reverse.to_wkt)
+  end
+
+  def test_store_keys_on_options
+    store = RGeo::CoordSys::CRSStore.send(:new)
+    default = store.get(from, to)
+    hinted = store.get(from, to, area: [-5.0, 42.0, 8.0, 51.0])
+    refute_same(default, hinted)
+    assert_same(hinted, store.get(from, to, area: [-5.0, 42.0, 8.0, 51.0], accuracy: nil))
+  end
+
+  def test_store_capacity
+    store = RGeo::CoordSys::CRSStore.send(:new)
+    store.capacity = 1
+    first = store.get(from, to)
+    store.get(to, from)
+    assert_equal(1, store.stats[:size])
+    assert_equal(1, store.stats[:evictions])
+    refute_same(first, store.get(from, to))
+    assert_raises(ArgumentError) { store.capacity = 0 }
+  end
+
+  private
+
+  # Builds the Arrow C Data Interface structures of a float64 array holding
+  # values. The memory they point to is kept alive in keep.
+  def arrow_column(values, keep)
+    data = Fiddle::Pointer.malloc(values.size * 8, Fiddle::RUBY_FREE)
+    data[0, values.size * 8] = values.pack("d*")
+    buffers = Fiddle::Pointer.malloc(16, Fiddle::RUBY_FREE)
+    buffers[0, 16] = [0, data.to_i].pack("J2")
+    format = Fiddle::Pointer["g"]
+    array = Fiddle::Pointer.malloc(80, Fiddle::RUBY_FREE)
+    array[0, 80] = [values.size, 0, 0, 2, 0, buffers.to_i, 0, 0, 1, 0].pack("q5J5")
+    schema = Fiddle::Pointer.malloc(72, Fiddle::RUBY_FREE)
+    schema[0, 72] = [format.to_i, 0, 0, 0, 0, 0, 0, 1, 0].pack("J3q2J4")
+    keep.push(data, buffers, format, array, schema)
+    [array.to_i, schema.to_i]
+  end
 end
@@ -0,0 +1,124 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestCoordSysFastPath < Minitest::Test # :nodoc:
+  METERS = 1e-6
+  DEGREES = 1e-11
+
+  def teardown
+    RGeo::CoordSys::CRSToCRS.fast_paths = true
+  end
+
+  def crs(definition)
+    RGeo::CoordSys::Proj4.create(definition)
+  end
+
+  # Creates the pipeline between from and to with and without fast paths.
+  def pipelines(from, to)
+    fast = RGeo::CoordSys::CRSToCRS.create(crs(from), crs(to))
+    RGeo::CoordSys::CRSToCRS.fast_paths = false
+    exact = RGeo::CoordSys::CRSToCRS.create(crs(from), crs(to))
+    RGeo::CoordSys::CRSToCRS.fast_paths = true
+    assert_nil(exact.fast_path)
+    [fast, exact]
+  end
+
+  def lattice(xmin, ymin, xmax, ymax, steps)
+    (0..steps).flat_map do |i|
+      (0..steps).flat_map do |j|
+        [xmin + (xmax - xmin) * i / steps, ymin + (ymax - ymin) * j / steps]
+      end
+    end
+  end
+
+  def assert_agree(fast, exact, coords, tolerance)
+    expected = coords.pack("d*")
+    actual = coords.pack("d*")
+    exact.transform_buffer(expected)
+    fast.transform_buffer(actual)
+    expected.unpack("d*").zip(actual.unpack("d*")).each do |e, a|
+      assert_in_delta(e, a, tolerance)
+    end
+    actual.unpack("d*")
+  end
+
+  def test_web_mercator
+    fast, exact = pipelines("EPSG:4326", "EPSG:3857")
+    assert_equal(:web_mercator, fast.fast_path)
+    projected = assert_agree(fast, exact, lattice(-180.0, -85.0, 180.0, 85.0, 40), METERS)
+    assert_agree(fast.inverse, exact.inverse, projected, DEGREES)
+  end
+
+  def test_legacy_web_mercator
+    fast, exact = pipelines(
+      "+proj=longlat +datum=WGS84 +no_defs +type=crs",
+      "+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs +type=crs"
+    )
+    assert_equal(:web_mercator, fast.fast_path)
+    assert_agree(fast, exact, lattice(-180.0, -85.0, 180.0, 85.0, 20), METERS)
+  end
+
+  def test_utm
+    fast, exact = pipelines("EPSG:4326", "EPSG:32631")
+    assert_equal(:utm, fast.fast_path)
+    projected = assert_agree(fast, exact, lattice(-3.0, -80.0, 9.0, 84.0, 40), METERS)
+    assert_agree(fast.inverse, exact.inverse, projected, DEGREES)
+  end
+
+  def test_utm_south
+    fast, exact = pipelines("EPSG:32756", "EPSG:4326")
+    assert_equal(:utm, fast.fast_path)
+    geographic = lattice(147.0, -80.0, 159.0, 0.0, 20)
+    projected = assert_agree(fast.inverse, exact.inverse, geographic, METERS)
+    assert_agree(fast, exact, projected, DEGREES)
+  end
+
+  def test_outside_of_kernel_domain
+    fast, exact = pipelines("EPSG:4326", "EPSG:3857")
+    coords = [0.0, 89.9999999, 10.0, 90.0, 0.0, 95.0, 10.0, 45.0]
+    expected = coords.pack("d*")
+    actual = coords.pack("d*")
+    exact.transform_buffer(expected)
+    fast.transform_buffer(actual)
+    assert_equal(expected.unpack("d*")[0, 6], actual.unpack("d*")[0, 6])
+  end
+
+  def test_transform_coords
+    fast, exact = pipelines("EPSG:4326", "EPSG:32631")
+    expected = exact.transform_coords(2.35, 48.85, 35.0)
+    actual = fast.transform_coords(2.35, 48.85, 35.0)
+    assert_in_delta(expected[0], actual[0], METERS)
+    assert_in_delta(expected[1], actual[1], METERS)
+    assert_equal(35.0, actual[2])
+  end
+
+  def test_identity
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(crs("EPSG:4326"), crs("EPSG:4326"))
+    assert_equal(:identity, crs_to_crs.fast_path)
+    coords = [2.35, 48.85, 181.0, 95.0, Float::INFINITY, 0.0]
+    src = coords.pack("d*")
+    out = "\0".b * src.bytesize
+    status = RGeo::CoordSys::TransformStatus.new
+    crs_to_crs.transform_buffer(src, out: out, status: status)
+    assert_equal(src, out)
+    assert_equal([2], status.failed_indices)
+    assert_equal(src, coords.pack("d*"))
+  end
+
+  def test_identity_between_units
+    degrees = crs("EPSG:4326")
+    radians = RGeo::CoordSys::Proj4.create("EPSG:4326", radians: true)
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(degrees, radians)
+    assert_nil(crs_to_crs.fast_path)
+    buffer = [180.0, 90.0].pack("d*")
+    crs_to_crs.transform_buffer(buffer)
+    assert_in_delta(Math::PI, buffer.unpack1("d"), 1e-12)
+  end
+
+  def test_disabled
+    RGeo::CoordSys::CRSToCRS.fast_paths = false
+    refute(RGeo::CoordSys::CRSToCRS.fast_paths)
+    assert_nil(RGeo::CoordSys::CRSToCRS.create(crs("EPSG:4326"), crs("EPSG:3857")).fast_path)
+  end
+end
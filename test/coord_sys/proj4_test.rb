@@ -119,18 +119,50 @@ class TestProj4 < Minitest::Test # :nodoc:
     assert_xy_close(unproject_merc(-20_000_000, -20_000_000), RGeo::CoordSys::Proj4.transform_coords(projection, geography, -20_000_000, -20_000_000, nil))
   end
 
+  def test_radians_with_inverse_and_wkb
+    geography = RGeo::CoordSys::Proj4.create("+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs +type=crs", radians: true)
+    projection = RGeo::CoordSys::Proj4.create("+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs +type=crs")
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(geography, projection)
+    assert_xy_close([1, 1], crs_to_crs.inverse.transform_coords(*project_merc(1, 1), nil))
+
+    wkb = [1, 1, 0.01, 0.01].pack("CVE2")
+    assert_xy_close(project_merc(0.01, 0.01), crs_to_crs.transform_wkb(wkb)[5, 16].unpack("E2"))
+  end
+
+  def test_transform_buffer
+    geography = RGeo::CoordSys::Proj4.create("+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs +type=crs", radians: true)
+    projection = RGeo::CoordSys::Proj4.create("+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs +type=crs")
+    buffer = [0.01, 0.01, -1, -1].pack("d*")
+    RGeo::CoordSys::Proj4.transform_buffer(geography, projection, buffer)
+    values = buffer.unpack("d*")
+    assert_xy_close(project_merc(0.01, 0.01), values[0, 2])
+    assert_xy_close(project_merc(-1, -1), values[2, 2])
+
+    RGeo::CoordSys::Proj4.transform_buffer(projection, geography, buffer)
+    assert_xy_close([0.01, 0.01], buffer.unpack("d*")[0, 2])
+  end
+
   def test_equivalence
     proj1 = RGeo::CoordSys::Proj4.create("+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs +type=crs")
-    proj2 = RGeo::CoordSys::Proj4.create(" +proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs +type=crs")
+    proj2 = RGeo::CoordSys::Proj4.create(" +proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs +type=crs", cache: false)
     assert_equal(proj1, proj2)
   end
 
   def test_hashes_equal_for_equivalent_objects
     proj1 = RGeo::CoordSys::Proj4.create("+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs +type=crs")
-    proj2 = RGeo::CoordSys::Proj4.create(" +proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs +type=crs")
+    proj2 = RGeo::CoordSys::Proj4.create(" +proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs +type=crs", cache: false)
     assert_equal(proj1.hash, proj2.hash)
   end
 
+  def test_equivalence_of_different_definitions
+    proj1 = RGeo::CoordSys::Proj4.create("EPSG:4326")
+    proj2 = RGeo::CoordSys::Proj4.create("+proj=longlat +datum=WGS84 +no_defs +type=crs")
+    assert_equal(proj1, proj2)
+    assert_equal(proj1.hash, proj2.hash)
+    refute_equal(proj1, RGeo::CoordSys::Proj4.create("EPSG:4326", radians: true))
+    refute_equal(proj1, RGeo::CoordSys::Proj4.create("EPSG:3857"))
+  end
+
   def test_point_projection_cast
     geography = RGeo::Geos.factory(coord_sys: "+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs +type=crs", srid: 4326)
     projection = RGeo::Geos.factory(coord_sys: "+proj=tmerc +lat_0=49 +lon_0=-2 +k=0.9996012717 +x_0=400000 +y_0=-100000 +ellps=airy +datum=OSGB36 +units=m +no_defs +type=crs", srid: 27_700)
@@ -181,6 +213,79 @@ class TestProj4 < Minitest::Test # :nodoc:
     assert_equal(obj1, obj2)
   end
 
+  def test_create_is_cached
+    obj1 = RGeo::CoordSys::Proj4.create("EPSG:4326")
+    created = RGeo::CoordSys.stats[:crs_created]
+    obj2 = RGeo::CoordSys::Proj4.create(" epsg:4326")
+    assert_equal(obj1, obj2)
+    assert_equal(obj1, RGeo::CoordSys::Proj4.create(4326))
+    assert_equal(created, RGeo::CoordSys.stats[:crs_created])
+    refute_equal(obj1, RGeo::CoordSys::Proj4.create("EPSG:4326", radians: true))
+
+    # Callers get their own mutable copy.
+    refute_same(obj1, obj2)
+    refute(obj2.frozen?)
+    assert_equal(" epsg:4326", obj2.original_str)
+    assert_equal("EPSG:4326", obj1.original_str)
+    obj2.dimension = 3
+    assert_equal(2, obj1.dimension)
+    refute(obj2.canonical_str.frozen?)
+  end
+
+  def test_create_cache_keeps_laziness
+    RGeo::CoordSys::Proj4.create("EPSG:2154")
+    refute(RGeo::CoordSys::Proj4.create("EPSG:2154", lazy: true)._resolved?)
+    assert(RGeo::CoordSys::Proj4.create("EPSG:2154")._resolved?)
+  end
+
+  def test_preload
+    from = RGeo::CoordSys::Proj4.create("EPSG:4326")
+    pairs = RGeo::CoordSys::Proj4.preload([[from, 3857], ["EPSG:3857", "EPSG:4326", { allow_ballpark: false }]])
+
+    assert_equal(2, pairs.size)
+    assert_same(pairs[0], RGeo::CoordSys::CRSStore.get(from, RGeo::CoordSys::Proj4.create(3857)))
+    assert_same(pairs[1], RGeo::CoordSys::CRSStore.get(RGeo::CoordSys::Proj4.create("EPSG:3857"), from,
+                                                       allow_ballpark: false))
+    assert_raises(RGeo::Error::InvalidProjection) { RGeo::CoordSys::Proj4.preload([["foo", from]]) }
+  end
+
+  def test_create_without_cache
+    obj1 = RGeo::CoordSys::Proj4.create("EPSG:4326")
+    obj2 = RGeo::CoordSys::Proj4.create("EPSG:4326", cache: false)
+    refute_same(obj1, obj2)
+    refute(obj2.frozen?)
+    assert_equal(obj1, obj2)
+  end
+
+  def test_lazy_create
+    proj = RGeo::CoordSys::Proj4.create("EPSG:2056", lazy: true, cache: false)
+    refute(proj._resolved?)
+    assert_equal("EPSG:2056", proj.original_str)
+    refute(proj.dup._resolved?)
+
+    assert(proj.projected?)
+    assert(proj._resolved?)
+    assert_equal(2, proj.dimension)
+    assert_equal("EPSG:2056", proj.auth_name)
+    assert_equal(RGeo::CoordSys::Proj4.create("EPSG:2056"), proj)
+
+    invalid = RGeo::CoordSys::Proj4.create("foo", lazy: true, cache: false)
+    refute(invalid._valid?)
+    assert_raises(RGeo::Error::InvalidProjection) { RGeo::CoordSys::Proj4.create("foo") }
+  end
+
+  def test_copies_share_pj
+    obj1 = RGeo::CoordSys::Proj4.create("EPSG:4326")
+    obj2 = obj1.get_geographic
+    created = RGeo::CoordSys.stats[:crs_created]
+
+    assert_equal(obj1, obj1.dup)
+    assert_equal(obj2, obj2.dup)
+    assert_equal(obj1, ::Marshal.load(::Marshal.dump(obj1)))
+    assert_equal(obj1, psych_load(Psych.dump(obj1)))
+    assert_equal(created, RGeo::CoordSys.stats[:crs_created])
+  end
+
   def test_dup_of_get_geographic
     obj1 = RGeo::CoordSys::Proj4.create("+proj=latlong +datum=WGS84 +ellps=WGS84 +type=crs")
     obj2 = obj1.get_geographic
@@ -0,0 +1,39 @@
+# frozen_string_literal: true
+
+require "test_helper"
+require "objspace"
+
+class TestCoordSysStats < Minitest::Test # :nodoc:
+  def setup
+    RGeo::CoordSys.reset_stats
+  end
+
+  def test_counts_creations_and_transforms
+    from = RGeo::CoordSys::Proj4.create("+proj=lcc +lat_1=49 +lat_2=44 +lat_0=46.5 +lon_0=3 +x_0=700000 +y_0=6600000 +ellps=GRS80 +towgs84=0,0,0,0,0,0,0 +units=m +no_defs +type=crs", cache: false)
+    to = RGeo::CoordSys::Proj4.create("+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs +type=crs", cache: false)
+    crs_to_crs = RGeo::CoordSys::CRSToCRS.create(from, to)
+    crs_to_crs.transform_coords(733_345.6496818807, 6_750_247.713332973, nil)
+    crs_to_crs.transform_buffer(([733_345.6496818807, 6_750_247.713332973] * 3).pack("d*"))
+
+    stats = RGeo::CoordSys.stats
+    assert_equal(2, stats[:crs_created])
+    assert_equal(1, stats[:pipelines_created])
+    assert_equal(4, stats[:points_transformed])
+    assert_equal(0, stats[:proj_errors])
+    assert_operator(stats[:pipeline_create_time], :>=, 0)
+    assert_kind_of(Hash, stats[:crs_store])
+    assert_kind_of(Hash, stats[:proj4_cache])
+  end
+
+  def test_counts_errors
+    assert_raises(RGeo::Error::InvalidProjection) do
+      RGeo::CoordSys::Proj4.create("+proj=invalid", cache: false)
+    end
+    assert_equal(1, RGeo::CoordSys.stats[:proj_errors])
+  end
+
+  def test_memsize
+    proj = RGeo::CoordSys::Proj4.create("EPSG:4326", cache: false)
+    assert_operator(ObjectSpace.memsize_of(proj), :>, 1024)
+  end
+end
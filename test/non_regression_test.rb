@@ -20,4 +20,68 @@ class NonRegressionTest < Minitest::Test
     rescue Errno::ESRCH # rubocop:disable Lint/SuppressedException
     end
   end
+
+  def test_transform_after_fork
+    skip "fork is not supported" unless Process.respond_to?(:fork)
+    geography = RGeo::CoordSys::Proj4.create("EPSG:4326")
+    projection = RGeo::CoordSys::Proj4.create("EPSG:3857")
+    expected = RGeo::CoordSys::Proj4.transform_coords(geography, projection, 1, 2)
+
+    reader, writer = IO.pipe
+    pid = Process.fork do
+      reader.close
+      writer.write(Marshal.dump(RGeo::CoordSys::Proj4.transform_coords(geography, projection, 1, 2)))
+      writer.close
+      exit!(0)
+    end
+    writer.close
+    actual = Marshal.load(reader.read)
+    Process.wait pid
+
+    assert_equal(expected, actual)
+  ensure
+    reader&.close
+  end
+
+  def test_preload_before_fork
+    skip "fork is not supported" unless Process.respond_to?(:fork)
+    crs_to_crs, = RGeo::CoordSys::Proj4.preload([["EPSG:4326", "EPSG:3857"]])
+    expected = crs_to_crs.transform_coords(1, 2, nil)
+
+    reader, writer = IO.pipe
+    pid = Process.fork do
+      reader.close
+      created = RGeo::CoordSys.stats[:pipelines_created]
+      transform = RGeo::CoordSys::Proj4.preload([["EPSG:4326", "EPSG:3857"]]).first
+      result = [transform.equal?(crs_to_crs), transform.transform_coords(1, 2, nil),
+                RGeo::CoordSys.stats[:pipelines_created] - created]
+      writer.write(Marshal.dump(result))
+      writer.close
+      exit!(0)
+    end
+    writer.close
+    actual = Marshal.load(reader.read)
+    Process.wait pid
+
+    assert_equal([true, expected, 0], actual)
+  ensure
+    reader&.close
+  end
+
+  def test_ractor_shareable
+    skip "Ractor is not supported" unless defined?(Ractor)
+    from = RGeo::CoordSys::Proj4.create("+proj=lcc +lat_1=49 +lat_2=44 +lat_0=46.5 +lon_0=3 +x_0=700000 +y_0=6600000 +ellps=GRS80 +towgs84=0,0,0,0,0,0,0 +units=m +no_defs +type=crs")
+    to = RGeo::CoordSys::Proj4.create("+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs +type=crs")
+    crs_to_crs = Ractor.make_shareable(RGeo::CoordSys::CRSToCRS.create(from, to))
+    expected = crs_to_crs.transform_coords(733_345.6496818807, 6_750_247.713332973, nil)
+
+    ractors = Array.new(2) do
+      Ractor.new(crs_to_crs) do |transform|
+        transform.transform_coords(733_345.6496818807, 6_750_247.713332973, nil)
+      end
+    end
+    ractors.each do |ractor|
+      assert_equal(expected, ractor.respond_to?(:value) ? ractor.value : ractor.take)
+    end
+  end
 end